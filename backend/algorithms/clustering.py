@@ -4,23 +4,34 @@ Groups similar songs together based on their attributes
 """
 
 import time
+import json
+import math
 import random
+from itertools import islice, repeat
+from concurrent.futures import ThreadPoolExecutor
+
+from data_structures.feature_store import default_feature_store
 from collections import defaultdict
 
 class MusicClusterer:
-    def __init__(self, k=5):
+    def __init__(self, k=5, feature_store=None):
         self.k = k  # Number of clusters
+        self.feature_store = feature_store or default_feature_store
         self.execution_time = 0
         self.centroids = []
         self.labels = []
         
-    def cluster_songs(self, songs, max_iterations=100):
+    def cluster_songs(self, songs, max_iterations=100, table=None):
         """
         Cluster songs using K-Means algorithm
         Songs are represented by genre and artist features
+        When the request's SongTable is given, features and labels are read from its columns
         """
         start_time = time.time()
         
+        if table is not None:
+            songs = range(len(table))
+        
         if len(songs) == 0:
             self.execution_time = time.time() - start_time
             return {}
@@ -29,70 +40,79 @@ class MusicClusterer:
         k = min(self.k, len(songs))
         
         # Extract features from songs
-        features = self._extract_features(songs)
+        if table is not None:
+            features = self.feature_store.vectors_for_table(table)
+        else:
+            features = self._extract_features(songs)
+        
+        self.centroids, self.labels = self._fit_features(features, k, max_iterations)
+        
+        self.execution_time = time.time() - start_time
+        
+        # Prepare result
+        result = self._prepare_result(songs, self.labels, features, table)
         
+        return result
+    
+    def _fit_features(self, features, k, max_iterations=100):
+        """
+        Run K-Means on already extracted features
+        Touches no instance state, so several k values can be fitted concurrently
+        Returns (centroids, labels)
+        """
         # Initialize centroids randomly
-        self.centroids = random.sample(features, k)
+        centroids = [list(c) for c in random.sample(features, k)]
         
         # K-Means iterations
         for iteration in range(max_iterations):
             # Assign each point to nearest centroid
-            clusters = self._assign_to_clusters(features, self.centroids)
+            clusters = self._assign_to_clusters(features, centroids)
             
             # Calculate new centroids
-            new_centroids = self._calculate_centroids(clusters)
+            new_centroids = self._calculate_centroids(clusters, centroids)
             
             # Check for convergence
-            if self._has_converged(self.centroids, new_centroids):
+            if self._has_converged(centroids, new_centroids):
                 break
             
-            self.centroids = new_centroids
+            centroids = new_centroids
         
         # Assign labels
-        self.labels = [self._find_nearest_centroid(f, self.centroids) for f in features]
-        
-        self.execution_time = time.time() - start_time
-        
-        # Prepare result
-        result = self._prepare_result(songs, self.labels)
+        labels = [self._find_nearest_centroid(f, centroids) for f in features]
         
-        return result
+        return centroids, labels
     
     def _extract_features(self, songs):
         """
-        Extract numerical features from songs
-        Feature vector: [genre_id, artist_hash, price]
+        Read feature vectors from the feature store
+        Vector: [hashed genre one-hot, hashed artist one-hot, scaled price, audio attributes]
         """
-        # Create mappings for genres and artists
-        genres = list(set(song.get('genre', 'Unknown') for song in songs))
-        artists = list(set(song.get('artist', 'Unknown') for song in songs))
-        
-        genre_to_id = {genre: i for i, genre in enumerate(genres)}
-        artist_to_id = {artist: i for i, artist in enumerate(artists)}
-        
-        features = []
-        for song in songs:
-            genre = song.get('genre', 'Unknown')
-            artist = song.get('artist', 'Unknown')
-            price = song.get('price', 0) or 0
-            
-            feature = [
-                genre_to_id.get(genre, 0),
-                artist_to_id.get(artist, 0),
-                float(price) * 10  # Scale price
-            ]
-            features.append(feature)
-        
-        return features
+        return self.feature_store.vectors_for(songs)
     
     def _euclidean_distance(self, point1, point2):
         """Calculate Euclidean distance between two points"""
-        return sum((a - b) ** 2 for a, b in zip(point1, point2)) ** 0.5
+        return math.dist(point1, point2)
+    
+    def _squared_distance(self, point1, point2):
+        """Squared Euclidean distance (no sqrt, same ordering)"""
+        total = 0.0
+        for a, b in zip(point1, point2):
+            diff = a - b
+            total += diff * diff
+        return total
     
     def _find_nearest_centroid(self, point, centroids):
         """Find the index of the nearest centroid"""
-        distances = [self._euclidean_distance(point, centroid) for centroid in centroids]
-        return distances.index(min(distances))
+        best_index = 0
+        best_distance = float('inf')
+        
+        for index, centroid in enumerate(centroids):
+            distance = self._squared_distance(point, centroid)
+            if distance < best_distance:
+                best_index = index
+                best_distance = distance
+        
+        return best_index
     
     def _assign_to_clusters(self, features, centroids):
         """Assign each feature vector to the nearest centroid"""
@@ -104,11 +124,11 @@ class MusicClusterer:
         
         return clusters
     
-    def _calculate_centroids(self, clusters):
+    def _calculate_centroids(self, clusters, old_centroids):
         """Calculate new centroids as mean of cluster points"""
         new_centroids = []
         
-        for cluster_id in range(self.k):
+        for cluster_id in range(len(old_centroids)):
             if cluster_id in clusters and clusters[cluster_id]:
                 points = clusters[cluster_id]
                 n_features = len(points[0])
@@ -120,11 +140,8 @@ class MusicClusterer:
                 ]
                 new_centroids.append(centroid)
             else:
-                # If cluster is empty, keep old centroid or create random
-                if cluster_id < len(self.centroids):
-                    new_centroids.append(self.centroids[cluster_id])
-                else:
-                    new_centroids.append([0] * len(self.centroids[0]))
+                # If cluster is empty, keep old centroid
+                new_centroids.append(old_centroids[cluster_id])
         
         return new_centroids
     
@@ -139,55 +156,117 @@ class MusicClusterer:
         
         return True
     
-    def _prepare_result(self, songs, labels):
+    def _prepare_result(self, songs, labels, features, table=None):
         """Prepare clustering result"""
         clusters = defaultdict(list)
         
         for i, song in enumerate(songs):
             cluster_id = labels[i]
-            clusters[f'cluster_{cluster_id}'].append({
-                'title': song.get('title', 'Unknown'),
-                'artist': song.get('artist', 'Unknown'),
-                'genre': song.get('genre', 'Unknown')
-            })
+            if table is not None:
+                member = {field: table.label(field, i) for field in ('title', 'artist', 'genre')}
+            else:
+                member = {
+                    'title': song.get('title', 'Unknown'),
+                    'artist': song.get('artist', 'Unknown'),
+                    'genre': song.get('genre', 'Unknown')
+                }
+            clusters[f'cluster_{cluster_id}'].append(member)
+        
+        silhouette = self._calculate_silhouette_score(features, labels)
         
         # Calculate cluster statistics
         result = {
             'clusters': dict(clusters),
             'cluster_sizes': {k: len(v) for k, v in clusters.items()},
             'total_clusters': len(clusters),
-            'silhouette_score': self._calculate_silhouette_score(labels)
+            'silhouette_score': silhouette['score'],
+            'silhouette_confidence': silhouette['confidence'],
+            'silhouette_method': silhouette['method']
         }
         
         return result
     
-    def _calculate_silhouette_score(self, labels):
+    def _calculate_silhouette_score(self, features, labels, exact_limit=300,
+                                    sample_size=300, reference_size=200):
         """
-        Calculate simplified silhouette score
-        Measures how well clustered the data is
+        Calculate the silhouette score: mean of (b - a) / max(a, b) where
+        a = mean distance to the point's own cluster, b = mean distance to the nearest other cluster
+        Exact O(n^2) for up to exact_limit points; above that sample_size points are scored against
+        at most reference_size random members of each cluster, so the cost no longer grows with n
+        Returns {'score', 'confidence', 'method'} (confidence = 95% half-width, 0 when exact)
         """
-        if len(set(labels)) <= 1:
+        n = len(labels)
+        if len(set(labels)) <= 1 or n < 2:
+            return {'score': 0.0, 'confidence': 0.0, 'method': 'exact'}
+        
+        # Group point indices by cluster once
+        members = defaultdict(list)
+        for index, label in enumerate(labels):
+            members[label].append(index)
+        
+        if n <= exact_limit:
+            indices = range(n)
+            references = members
+            method = 'exact'
+        else:
+            indices = random.sample(range(n), min(sample_size, n))
+            references = {label: random.sample(group, min(reference_size, len(group)))
+                          for label, group in members.items()}
+            method = 'sampled'
+        
+        # Each cluster's reference vectors are gathered once for every scored point
+        cluster_points = {label: [features[j] for j in group] for label, group in references.items()}
+        reference_sets = {label: set(group) for label, group in references.items()}
+        sizes = {label: len(group) for label, group in members.items()}
+        values = [self._point_silhouette(i, features, labels, cluster_points, reference_sets, sizes)
+                  for i in indices]
+        
+        mean = sum(values) / len(values)
+        confidence = 0.0
+        
+        if method == 'sampled' and len(values) > 1:
+            variance = sum((v - mean) ** 2 for v in values) / (len(values) - 1)
+            confidence = 1.96 * (variance / len(values)) ** 0.5
+        
+        return {
+            'score': round(mean, 3),
+            'confidence': round(confidence, 3),
+            'method': method
+        }
+    
+    def _point_silhouette(self, index, features, labels, cluster_points, reference_sets, sizes):
+        """Silhouette value of a single point (0 for singleton clusters)"""
+        own_label = labels[index]
+        if sizes[own_label] <= 1:
             return 0.0
         
-        # Simplified calculation
-        cluster_counts = defaultdict(int)
-        for label in labels:
-            cluster_counts[label] += 1
+        point = features[index]
+        a = 0.0
+        b = float('inf')
         
-        # Higher score if clusters are more balanced
-        ideal_size = len(labels) / len(set(labels))
-        variance = sum((count - ideal_size) ** 2 for count in cluster_counts.values())
-        
-        # Normalize to [0, 1]
-        score = 1.0 / (1.0 + variance / len(labels))
+        for label, points in cluster_points.items():
+            # math.dist runs the distance loop in C
+            total = sum(map(math.dist, repeat(point, len(points)), points))
+            
+            if label == own_label:
+                # Distance to itself is zero, so only exclude it from the count
+                # (a sampled reference set may not contain the point)
+                count = len(points) - (index in reference_sets[label])
+                a = total / count if count else 0.0
+            else:
+                b = min(b, total / len(points))
         
-        return round(score, 3)
+        denominator = max(a, b)
+        return (b - a) / denominator if denominator > 0 else 0.0
     
     def predict_cluster(self, song_features):
-        """Predict which cluster a new song belongs to"""
+        """Predict which cluster a new song (song dict or feature vector) belongs to"""
         if not self.centroids:
             return -1
         
+        if isinstance(song_features, dict):
+            song_features = self.feature_store.vector(song_features)
+        
         return self._find_nearest_centroid(song_features, self.centroids)
     
     def get_cluster_summary(self):
@@ -202,31 +281,194 @@ class MusicClusterer:
         
         return dict(summary)
     
-    def elbow_method(self, songs, max_k=10):
+    def elbow_method(self, songs, max_k=10, max_workers=None):
         """
         Use elbow method to find optimal number of clusters
         Returns list of (k, inertia) tuples
         """
         features = self._extract_features(songs)
-        results = []
+        k_values = range(2, min(max_k + 1, len(songs)))
         
-        for k in range(2, min(max_k + 1, len(songs))):
-            self.k = k
-            self.cluster_songs(songs, max_iterations=50)
-            
-            # Calculate inertia (within-cluster sum of squares)
-            inertia = self._calculate_inertia(features)
-            results.append((k, inertia))
+        results = self.evaluate_k_values(features, k_values, max_iterations=50,
+                                         max_workers=max_workers)
         
-        return results
+        return [(k, results[k]['inertia']) for k in k_values]
     
-    def _calculate_inertia(self, features):
+    def evaluate_k_values(self, features, k_values, max_iterations=50, max_workers=None):
+        """
+        Fit one independent model per candidate k on a thread pool
+        Features are extracted once by the caller and shared read-only
+        Returns {k: {'inertia', 'centroids', 'labels'}}
+        """
+        k_values = [k for k in k_values if 1 <= k <= len(features)]
+        
+        def fit(k):
+            centroids, labels = self._fit_features(features, k, max_iterations)
+            return k, {
+                'inertia': self._calculate_inertia(features, centroids, labels),
+                'centroids': centroids,
+                'labels': labels
+            }
+        
+        with ThreadPoolExecutor(max_workers=max_workers) as executor:
+            return dict(executor.map(fit, k_values))
+    
+    def select_k(self, songs, min_k=2, max_k=10, max_workers=None):
+        """
+        Pick k at the elbow: the point furthest below the line joining
+        the first and last (k, inertia) points
+        Returns (best_k, [(k, inertia), ...])
+        """
+        features = self._extract_features(songs)
+        k_values = range(min_k, min(max_k, len(songs)) + 1)
+        results = self.evaluate_k_values(features, k_values, max_workers=max_workers)
+        curve = [(k, results[k]['inertia']) for k in sorted(results)]
+        
+        if len(curve) < 3:
+            return (curve[0][0] if curve else min(self.k, len(songs))), curve
+        
+        (k1, i1), (k2, i2) = curve[0], curve[-1]
+        
+        def gap(point):
+            k, inertia = point
+            line = i1 + (i2 - i1) * (k - k1) / (k2 - k1)
+            return line - inertia
+        
+        best_k = max(curve, key=gap)[0]
+        return best_k, curve
+    
+    def _calculate_inertia(self, features, centroids=None, labels=None):
         """Calculate within-cluster sum of squared distances"""
+        centroids = self.centroids if centroids is None else centroids
+        labels = self.labels if labels is None else labels
         inertia = 0
         
         for i, feature in enumerate(features):
-            cluster_id = self.labels[i]
+            inertia += self._squared_distance(feature, centroids[labels[i]])
+        
+        return inertia
+
+class MiniBatchMusicClusterer(MusicClusterer):
+    """
+    Mini-Batch K-Means (Sculley, 2010)
+    Consumes songs in fixed-size batches so the whole catalog never has to be
+    held in memory, and keeps refining the same centroids as new songs arrive
+    """
+    def __init__(self, k=5, batch_size=1024, feature_store=None):
+        super().__init__(k, feature_store)
+        self.batch_size = batch_size
+        self.centroid_counts = []  # Songs absorbed by each centroid
+        self.songs_seen = 0
+    
+    def _extract_features(self, songs):
+        """
+        Encode each batch directly: a one-pass stream never reuses a vector, and caching it
+        would keep filling (and clearing) the store the online server relies on
+        """
+        return [self.feature_store.encode(song) for song in songs]
+    
+    def fit_stream(self, songs, max_batches=None):
+        """
+        Cluster songs from any iterable (list, generator, file reader)
+        Songs are pulled batch_size at a time
+        """
+        start_time = time.time()
+        
+        for batch_number, batch in enumerate(iter_song_batches(songs, self.batch_size)):
+            if max_batches is not None and batch_number >= max_batches:
+                break
+            self.partial_fit(batch)
+        
+        self.execution_time = time.time() - start_time
+        return self.get_stream_summary()
+    
+    def fit_file(self, path, max_batches=None):
+        """Cluster songs streamed from a JSON Lines (or JSON array) file"""
+        return self.fit_stream(iter_songs_from_file(path), max_batches)
+    
+    def partial_fit(self, songs):
+        """
+        Refine the existing centroids with one batch of songs
+        Each centroid moves towards its points with learning rate 1 / count
+        """
+        if not songs:
+            return self
+        
+        features = self._extract_features(songs)
+        self._seed_centroids(features)
+        
+        # Assign the whole batch against the current centroids first
+        assignments = [self._find_nearest_centroid(f, self.centroids) for f in features]
+        
+        # Then take a gradient step per point with a per-centroid learning rate
+        for feature, cluster_id in zip(features, assignments):
+            self.centroid_counts[cluster_id] += 1
+            rate = 1.0 / self.centroid_counts[cluster_id]
             centroid = self.centroids[cluster_id]
-            inertia += self._euclidean_distance(feature, centroid) ** 2
+            for i in range(len(centroid)):
+                centroid[i] += rate * (feature[i] - centroid[i])
         
-        return inertia
\ No newline at end of file
+        self.songs_seen += len(features)
+        return self
+    
+    def _seed_centroids(self, features):
+        """Sample initial centroids from incoming songs until we have k of them"""
+        missing = self.k - len(self.centroids)
+        if missing <= 0:
+            return
+        
+        for seed in random.sample(features, min(missing, len(features))):
+            self.centroids.append(list(seed))
+            self.centroid_counts.append(1)
+    
+    def predict(self, songs):
+        """Return the nearest cluster id for each song"""
+        if not self.centroids:
+            return [-1] * len(songs)
+        
+        features = self._extract_features(songs)
+        return [self._find_nearest_centroid(f, self.centroids) for f in features]
+    
+    def get_stream_summary(self):
+        """Get statistics about the streamed clustering"""
+        return {
+            'total_clusters': len(self.centroids),
+            'songs_seen': self.songs_seen,
+            'cluster_sizes': {
+                f'cluster_{i}': count - 1  # Discount the seed
+                for i, count in enumerate(self.centroid_counts)
+            },
+            'centroids': [list(c) for c in self.centroids]
+        }
+
+
+def iter_song_batches(songs, batch_size):
+    """Yield lists of at most batch_size songs from any iterable"""
+    iterator = iter(songs)
+    while True:
+        batch = list(islice(iterator, batch_size))
+        if not batch:
+            return
+        yield batch
+
+
+def iter_songs_from_file(path):
+    """
+    Stream songs from disk
+    JSON Lines files are read one line at a time, a plain JSON array is loaded whole
+    """
+    with open(path, 'r', encoding='utf-8') as f:
+        first = f.read(1)
+        while first and first.isspace():
+            first = f.read(1)
+        
+        if first == '[':
+            f.seek(0)
+            yield from json.load(f)
+            return
+        
+        f.seek(0)
+        for line in f:
+            line = line.strip()
+            if line:
+                yield json.loads(line)
@@ -0,0 +1,115 @@
+"""
+LSD Radix Sort
+Sorts (key, id) pairs by numeric keys in a fixed number of linear passes instead of comparisons
+"""
+
+from array import array
+
+# Below this size the bucket bookkeeping costs more than comparing
+RADIX_MIN_SIZE = 256
+
+RADIX_BITS = 8
+RADIX_BUCKETS = 1 << RADIX_BITS
+RADIX_MASK = RADIX_BUCKETS - 1
+
+SIGN_BIT = 1 << 63
+KEY_MASK = (1 << 64) - 1
+
+
+INT64_MIN = -(1 << 63)
+INT64_MAX = (1 << 63) - 1
+FLOAT_EXACT_INT = 1 << 53  # Larger ints may round when converted to float
+
+
+def key_kind(values):
+    """
+    How radix sort can order these keys without changing the comparison result:
+    'int'   - every key is an int within int64 (offset-binary keys, exact)
+    'float' - floats, plus ints small enough to convert to float exactly
+    None    - anything else (bools, NaN, huge ints, other types): use a comparison sort
+    """
+    all_ints = True
+    exact_as_float = True
+    for v in values:
+        kind = type(v)
+        if kind is int:
+            if not INT64_MIN <= v <= INT64_MAX:
+                return None
+            if not -FLOAT_EXACT_INT <= v <= FLOAT_EXACT_INT:
+                exact_as_float = False
+        elif kind is float:
+            if v != v:
+                return None  # NaN has no place in the ordering
+            all_ints = False
+        else:
+            return None  # bool is excluded here too (type(True) is bool, not int)
+    if all_ints:
+        return 'int'
+    return 'float' if exact_as_float else None
+
+
+def has_numeric_keys(values):
+    """True if radix sort orders these keys exactly like a comparison sort"""
+    return key_kind(values) is not None
+
+
+def to_sortable_keys(values, kind=None):
+    """
+    Map numbers to unsigned 64-bit integers with the same ordering
+    Ints: offset binary (add 2^63)
+    Floats: flip the sign bit of positives, every bit of negatives; -0.0 becomes 0.0 so the
+    two stay tied as they are for comparisons
+    """
+    kind = kind or key_kind(values)
+    if kind == 'int':
+        return [v + SIGN_BIT for v in values]
+    if kind != 'float':
+        raise ValueError("keys cannot be radix sorted exactly")
+
+    raw = array('Q')
+    raw.frombytes(array('d', (float(v) or 0.0 for v in values)).tobytes())
+    return [(bits ^ KEY_MASK) if bits & SIGN_BIT else (bits | SIGN_BIT) for bits in raw]
+
+
+def radix_sort_pairs(keys, ids, descending=False, kind=None):
+    """
+    Stable LSD radix sort of ids by numeric keys (kind: key_kind(keys) when already known)
+    Returns the ids in sorted order (ties keep their input order)
+    """
+    sortable = to_sortable_keys(keys, kind)
+
+    if descending:
+        sortable = [KEY_MASK - k for k in sortable]
+
+    pairs = list(zip(sortable, ids))
+
+    if len(pairs) < RADIX_MIN_SIZE:
+        _insertion_sort_pairs(pairs)
+        return [item_id for _, item_id in pairs]
+
+    # Only the bits that actually vary need a pass
+    low = min(sortable)
+    span = max(sortable) - low
+    pairs = [(k - low, item_id) for k, item_id in pairs]
+
+    shift = 0
+    while span >> shift:
+        buckets = [[] for _ in range(RADIX_BUCKETS)]
+        for pair in pairs:
+            buckets[(pair[0] >> shift) & RADIX_MASK].append(pair)
+
+        pairs = [pair for bucket in buckets for pair in bucket]
+        shift += RADIX_BITS
+
+    return [item_id for _, item_id in pairs]
+
+
+def _insertion_sort_pairs(pairs):
+    """Stable insertion sort fallback for small inputs"""
+    for i in range(1, len(pairs)):
+        item = pairs[i]
+        j = i - 1
+        while j >= 0 and pairs[j][0] > item[0]:
+            pairs[j + 1] = pairs[j]
+            j -= 1
+        pairs[j + 1] = item
@@ -3,14 +3,45 @@ Sorting Algorithms - QuickSort and MergeSort
 Used for sorting genres by various criteria
 """
 
+import os
 import time
+from concurrent.futures import ThreadPoolExecutor
+
+from algorithms.radix_sort import RADIX_MIN_SIZE, key_kind, radix_sort_pairs
+
+
+def _radix_order(mapping, descending=False):
+    """
+    Order the keys of {name: number} with LSD radix sort
+    Returns None when the input is too small or its keys cannot be radix sorted exactly
+    (use comparisons instead)
+    """
+    if len(mapping) < RADIX_MIN_SIZE:
+        return None
+    values = list(mapping.values())
+    kind = key_kind(values)
+    if kind is None:
+        return None
+    return radix_sort_pairs(values, list(mapping.keys()), descending, kind)
+
 
 class QuickSort:
+    """
+    Introsort (pattern-defeating QuickSort)
+    - median-of-three / ninther pivot, so sorted and reverse input stay O(n log n)
+    - three-way partition, so runs of equal scores are finished in one pass
+    - falls back to heapsort when recursion gets too deep (guaranteed O(n log n))
+    - explicit stack, always continuing with the smaller side (O(log n) stack, no recursion)
+    """
+    INSERTION_THRESHOLD = 16
+    NINTHER_THRESHOLD = 128
+    
     def __init__(self):
         self.comparison_count = 0
         self.execution_time = 0
+        self.engine = 'introsort'
         
-    def sort_by_score(self, genre_scores):
+    def sort_by_score(self, genre_scores, allow_radix=True):
         """
         Sort genres by their recommendation scores (descending)
         Returns sorted list of genre names
@@ -18,85 +49,236 @@ class QuickSort:
         start_time = time.time()
         self.comparison_count = 0
         
+        # Large numeric inputs take the radix path (no comparisons)
+        radix_result = _radix_order(genre_scores, descending=True) if allow_radix else None
+        if radix_result is not None:
+            self.engine = 'radix'
+            self.execution_time = time.time() - start_time
+            return radix_result
+        
+        self.engine = 'introsort'
+        
         # Convert to list of tuples
         items = [(genre, score) for genre, score in genre_scores.items()]
         
-        # Sort using quicksort
-        sorted_items = self._quicksort(items, 0, len(items) - 1)
+        # Sort using introsort (higher scores first)
+        sorted_items = self._introsort(items, lambda a, b: a[1] > b[1])
         
         self.execution_time = time.time() - start_time
         
         # Return just the genre names
         return [item[0] for item in sorted_items]
     
-    def _quicksort(self, arr, low, high):
-        """QuickSort implementation"""
-        if low < high:
-            # Partition the array
-            pi = self._partition(arr, low, high)
-            
-            # Recursively sort elements before and after partition
-            self._quicksort(arr, low, pi - 1)
-            self._quicksort(arr, pi + 1, high)
+    def top_k(self, genre_scores, k):
+        """
+        Top k genres by score (descending) without sorting the rest
+        Introselect moves the k best to the front in O(n), then only that prefix is sorted
+        """
+        start_time = time.time()
+        self.comparison_count = 0
+        self.engine = 'introselect'
         
-        return arr
-    
-    def _partition(self, arr, low, high):
-        """Partition function for QuickSort"""
-        # Choose rightmost element as pivot
-        pivot = arr[high][1]  # Score value
-        i = low - 1
+        items = [(genre, score) for genre, score in genre_scores.items()]
+        k = max(0, min(k, len(items)))
+        before = lambda a, b: a[1] > b[1]
         
-        for j in range(low, high):
-            self.comparison_count += 1
+        if 0 < k < len(items):
+            self._select(items, k, before)
+        
+        prefix = self._introsort(items[:k], before)
+        
+        self.execution_time = time.time() - start_time
+        return [item[0] for item in prefix]
+    
+    def _select(self, arr, k, before):
+        """
+        Partially order arr so arr[:k] holds the k first items (in any order)
+        Same partition as the sort; heap selection if the pivots keep going bad
+        """
+        low, high = 0, len(arr) - 1
+        depth = 2 * len(arr).bit_length()
+        
+        while high - low + 1 > self.INSERTION_THRESHOLD:
+            if depth == 0:
+                self._heapsort_range(arr, low, high, before)
+                return
+            depth -= 1
             
-            # Sort in descending order (higher scores first)
-            if arr[j][1] >= pivot:
-                i += 1
-                arr[i], arr[j] = arr[j], arr[i]
+            lt, gt = self._partition(arr, low, high, before)
+            
+            if k <= lt:
+                high = lt - 1
+            elif k > gt + 1:
+                low = gt + 1
+            else:
+                return  # The k-th position falls inside the run of pivot ties
         
-        arr[i + 1], arr[high] = arr[high], arr[i + 1]
-        return i + 1
+        self._insertion_sort(arr, low, high, before)
     
     def sort_by_name(self, genres):
         """Sort genres alphabetically"""
         start_time = time.time()
         self.comparison_count = 0
+        self.engine = 'introsort'
         
-        sorted_genres = self._quicksort_strings(genres.copy(), 0, len(genres) - 1)
+        sorted_genres = self._introsort(list(genres), lambda a, b: a < b)
         
         self.execution_time = time.time() - start_time
         return sorted_genres
     
-    def _quicksort_strings(self, arr, low, high):
-        """QuickSort for strings"""
-        if low < high:
-            pi = self._partition_strings(arr, low, high)
-            self._quicksort_strings(arr, low, pi - 1)
-            self._quicksort_strings(arr, pi + 1, high)
-        return arr
+    def _before(self, before, a, b):
+        """Counted comparison: True if a must come before b"""
+        self.comparison_count += 1
+        return before(a, b)
     
-    def _partition_strings(self, arr, low, high):
-        """Partition for string sorting"""
-        pivot = arr[high]
-        i = low - 1
+    def _introsort(self, arr, before):
+        """Sort arr in place with the strict ordering before(a, b)"""
+        n = len(arr)
+        if n < 2:
+            return arr
         
-        for j in range(low, high):
-            self.comparison_count += 1
-            if arr[j] <= pivot:
+        # Pattern check: already ordered input costs one linear pass
+        if self._is_sorted(arr, before):
+            return arr
+        
+        depth_limit = 2 * n.bit_length()
+        stack = [(0, n - 1, depth_limit)]
+        
+        while stack:
+            low, high, depth = stack.pop()
+            
+            while high - low + 1 > self.INSERTION_THRESHOLD:
+                if depth == 0:
+                    # Too many bad pivots, heapsort this range instead
+                    self._heapsort_range(arr, low, high, before)
+                    break
+                depth -= 1
+                
+                lt, gt = self._partition(arr, low, high, before)
+                
+                # Push the larger side, keep looping on the smaller one
+                if lt - low < high - gt:
+                    stack.append((gt + 1, high, depth))
+                    high = lt - 1
+                else:
+                    stack.append((low, lt - 1, depth))
+                    low = gt + 1
+            else:
+                self._insertion_sort(arr, low, high, before)
+        
+        return arr
+    
+    def _is_sorted(self, arr, before):
+        """Check if no element must come before its predecessor"""
+        for i in range(1, len(arr)):
+            if self._before(before, arr[i], arr[i - 1]):
+                return False
+        return True
+    
+    def _median_of_three(self, arr, i, j, k, before):
+        """Index of the median of arr[i], arr[j], arr[k]"""
+        if self._before(before, arr[j], arr[i]):
+            i, j = j, i
+        if self._before(before, arr[k], arr[j]):
+            j = k
+            if self._before(before, arr[j], arr[i]):
+                j = i
+        return j
+    
+    def _choose_pivot(self, arr, low, high, before):
+        """Median of three, or Tukey's ninther for large ranges"""
+        mid = (low + high) // 2
+        
+        if high - low + 1 < self.NINTHER_THRESHOLD:
+            return self._median_of_three(arr, low, mid, high, before)
+        
+        step = (high - low + 1) // 8
+        return self._median_of_three(
+            arr,
+            self._median_of_three(arr, low, low + step, low + 2 * step, before),
+            self._median_of_three(arr, mid - step, mid, mid + step, before),
+            self._median_of_three(arr, high - 2 * step, high - step, high, before),
+            before
+        )
+    
+    def _partition(self, arr, low, high, before):
+        """
+        Three-way partition around the pivot
+        Returns (lt, gt): arr[lt..gt] all tie with the pivot
+        """
+        pivot_index = self._choose_pivot(arr, low, high, before)
+        pivot = arr[pivot_index]
+        
+        lt, i, gt = low, low, high
+        while i <= gt:
+            if self._before(before, arr[i], pivot):
+                arr[lt], arr[i] = arr[i], arr[lt]
+                lt += 1
+                i += 1
+            elif self._before(before, pivot, arr[i]):
+                arr[i], arr[gt] = arr[gt], arr[i]
+                gt -= 1
+            else:
                 i += 1
-                arr[i], arr[j] = arr[j], arr[i]
         
-        arr[i + 1], arr[high] = arr[high], arr[i + 1]
-        return i + 1
+        return lt, gt
+    
+    def _insertion_sort(self, arr, low, high, before):
+        """Insertion sort for small ranges"""
+        for i in range(low + 1, high + 1):
+            item = arr[i]
+            j = i - 1
+            while j >= low and self._before(before, item, arr[j]):
+                arr[j + 1] = arr[j]
+                j -= 1
+            arr[j + 1] = item
+    
+    def _heapsort_range(self, arr, low, high, before):
+        """Heapsort arr[low..high] (introsort fallback)"""
+        n = high - low + 1
+        
+        for i in range(n // 2 - 1, -1, -1):
+            self._sift_down(arr, low, i, n, before)
+        
+        for end in range(n - 1, 0, -1):
+            arr[low], arr[low + end] = arr[low + end], arr[low]
+            self._sift_down(arr, low, 0, end, before)
+    
+    def _sift_down(self, arr, offset, root, size, before):
+        """Sift down within the heap stored at arr[offset:offset + size]"""
+        while True:
+            child = 2 * root + 1
+            if child >= size:
+                return
+            
+            # Pick the child that comes last in sorted order
+            if child + 1 < size and self._before(before, arr[offset + child], arr[offset + child + 1]):
+                child += 1
+            
+            if not self._before(before, arr[offset + root], arr[offset + child]):
+                return
+            
+            arr[offset + root], arr[offset + child] = arr[offset + child], arr[offset + root]
+            root = child
+
+
+def top_k_sorted(scores, k):
+    """
+    Return the k highest-scoring keys of {name: score}, best first
+    O(n + k log k) instead of a full O(n log n) sort
+    """
+    return QuickSort().top_k(scores, k)
 
 
 class MergeSort:
+    PARALLEL_MIN_SIZE = 1 << 15
+    
     def __init__(self):
         self.comparison_count = 0
         self.execution_time = 0
+        self.engine = 'mergesort'
         
-    def sort_by_distance(self, distances):
+    def sort_by_distance(self, distances, allow_radix=True):
         """
         Sort genres by their distances (ascending)
         Returns sorted list of genre names
@@ -104,6 +286,14 @@ class MergeSort:
         start_time = time.time()
         self.comparison_count = 0
         
+        radix_result = _radix_order(distances) if allow_radix else None
+        if radix_result is not None:
+            self.engine = 'radix'
+            self.execution_time = time.time() - start_time
+            return radix_result
+        
+        self.engine = 'mergesort'
+        
         # Convert to list of tuples
         items = [(genre, dist) for genre, dist in distances.items()]
         
@@ -116,41 +306,64 @@ class MergeSort:
         return [item[0] for item in sorted_items]
     
     def _mergesort(self, arr):
-        """MergeSort implementation"""
-        if len(arr) <= 1:
-            return arr
-        
-        # Divide array into two halves
-        mid = len(arr) // 2
-        left = self._mergesort(arr[:mid])
-        right = self._mergesort(arr[mid:])
-        
-        # Merge the sorted halves
-        return self._merge(left, right)
+        """MergeSort implementation (ascending by value)"""
+        return self._parallel_mergesort(arr, lambda a, b: a[1] <= b[1])
     
-    def _merge(self, left, right):
-        """Merge two sorted arrays"""
-        result = []
-        i = j = 0
+    def _mergesort_descending(self, arr):
+        """MergeSort for descending order"""
+        return self._parallel_mergesort(arr, lambda a, b: a[1] >= b[1])
+    
+    def _parallel_mergesort(self, arr, in_order):
+        """
+        Stable bottom-up merge sort with a single ping-pong buffer
+        in_order(a, b) is True when a may stay before b (ties keep input order)
+        Large inputs are split into one chunk per worker, sorted concurrently,
+        then merged pairwise with each merge split into co-ranked segments
+        """
+        n = len(arr)
+        buffer = arr[:]  # The only extra allocation
         
-        while i < len(left) and j < len(right):
-            self.comparison_count += 1
-            
-            # Sort by distance (ascending)
-            if left[i][1] <= right[j][1]:
-                result.append(left[i])
-                i += 1
-            else:
-                result.append(right[j])
-                j += 1
+        if n < self.PARALLEL_MIN_SIZE:
+            self.comparison_count += _sort_range(arr, buffer, 0, n, in_order)
+            return arr
         
-        # Append remaining elements
-        result.extend(left[i:])
-        result.extend(right[j:])
+        pool = _get_merge_pool()
+        workers = MERGE_WORKERS
+        
+        # Fork: sort one chunk per worker in place
+        bounds = [n * i // workers for i in range(workers + 1)]
+        futures = [
+            pool.submit(_sort_range, arr, buffer, bounds[i], bounds[i + 1], in_order)
+            for i in range(workers)
+        ]
+        self.comparison_count += sum(f.result() for f in futures)
+        
+        # Join: merge adjacent runs, alternating between arr and buffer
+        src, dst = arr, buffer
+        while len(bounds) > 2:
+            futures = []
+            next_bounds = [0]
+            
+            for i in range(0, len(bounds) - 1, 2):
+                lo = bounds[i]
+                if i + 2 < len(bounds):
+                    mid, hi = bounds[i + 1], bounds[i + 2]
+                    futures.extend(_submit_parallel_merge(pool, src, lo, mid, hi, dst, in_order, workers))
+                else:
+                    # Odd run out, carry it over unchanged
+                    hi = bounds[i + 1]
+                    dst[lo:hi] = src[lo:hi]
+                next_bounds.append(hi)
+            
+            self.comparison_count += sum(f.result() for f in futures)
+            bounds = next_bounds
+            src, dst = dst, src
         
-        return result
+        if src is not arr:
+            arr[:] = src
+        return arr
     
-    def sort_by_count(self, genre_counts):
+    def sort_by_count(self, genre_counts, allow_radix=True):
         """
         Sort genres by their frequency counts (descending)
         Returns sorted list of genre names
@@ -158,47 +371,25 @@ class MergeSort:
         start_time = time.time()
         self.comparison_count = 0
         
+        radix_result = _radix_order(genre_counts, descending=True) if allow_radix else None
+        if radix_result is not None:
+            self.engine = 'radix'
+            self.execution_time = time.time() - start_time
+            return radix_result
+        
+        self.engine = 'mergesort'
+        
         items = [(genre, count) for genre, count in genre_counts.items()]
         sorted_items = self._mergesort_descending(items)
         
         self.execution_time = time.time() - start_time
         return [item[0] for item in sorted_items]
     
-    def _mergesort_descending(self, arr):
-        """MergeSort for descending order"""
-        if len(arr) <= 1:
-            return arr
-        
-        mid = len(arr) // 2
-        left = self._mergesort_descending(arr[:mid])
-        right = self._mergesort_descending(arr[mid:])
-        
-        return self._merge_descending(left, right)
-    
-    def _merge_descending(self, left, right):
-        """Merge for descending order"""
-        result = []
-        i = j = 0
-        
-        while i < len(left) and j < len(right):
-            self.comparison_count += 1
-            
-            if left[i][1] >= right[j][1]:
-                result.append(left[i])
-                i += 1
-            else:
-                result.append(right[j])
-                j += 1
-        
-        result.extend(left[i:])
-        result.extend(right[j:])
-        
-        return result
-    
     def sort_artists(self, artist_data):
         """Sort artists by song count"""
         start_time = time.time()
         self.comparison_count = 0
+        self.engine = 'mergesort'
         
         items = [(artist, count) for artist, count in artist_data.items()]
         sorted_items = self._mergesort_descending(items)
@@ -207,6 +398,123 @@ class MergeSort:
         return dict(sorted_items)
 
 
+# Merge sort helpers (module level so pool workers share no sorter state)
+
+MERGE_RUN_SIZE = 32
+MERGE_WORKERS = os.cpu_count() or 4
+_merge_pool = None
+
+
+def _get_merge_pool():
+    """Shared fork-join pool for all MergeSort instances"""
+    global _merge_pool
+    if _merge_pool is None:
+        _merge_pool = ThreadPoolExecutor(max_workers=MERGE_WORKERS)
+    return _merge_pool
+
+
+def _sort_range(src, buffer, lo, hi, in_order):
+    """
+    Sort src[lo:hi] in place using buffer[lo:hi] as scratch
+    Returns the number of comparisons made
+    """
+    comparisons = 0
+    
+    # Short runs via insertion sort
+    for start in range(lo, hi, MERGE_RUN_SIZE):
+        comparisons += _insertion_sort_run(src, start, min(start + MERGE_RUN_SIZE, hi), in_order)
+    
+    # Bottom-up passes, ping-ponging between the two buffers
+    width = MERGE_RUN_SIZE
+    a, b = src, buffer
+    while width < hi - lo:
+        for start in range(lo, hi, 2 * width):
+            mid = min(start + width, hi)
+            end = min(start + 2 * width, hi)
+            comparisons += _merge_runs(a, start, mid, mid, end, b, start, in_order)
+        a, b = b, a
+        width *= 2
+    
+    if a is not src:
+        src[lo:hi] = a[lo:hi]
+    return comparisons
+
+
+def _insertion_sort_run(arr, lo, hi, in_order):
+    """Stable insertion sort of arr[lo:hi]"""
+    comparisons = 0
+    for i in range(lo + 1, hi):
+        item = arr[i]
+        j = i - 1
+        while j >= lo:
+            comparisons += 1
+            if in_order(arr[j], item):
+                break
+            arr[j + 1] = arr[j]
+            j -= 1
+        arr[j + 1] = item
+    return comparisons
+
+
+def _merge_runs(src, i, i_end, j, j_end, dst, k, in_order):
+    """Merge src[i:i_end] and src[j:j_end] into dst starting at k (left run wins ties)"""
+    comparisons = 0
+    while i < i_end and j < j_end:
+        comparisons += 1
+        if in_order(src[i], src[j]):
+            dst[k] = src[i]
+            i += 1
+        else:
+            dst[k] = src[j]
+            j += 1
+        k += 1
+    
+    # Copy the remaining tail
+    if i < i_end:
+        dst[k:k + i_end - i] = src[i:i_end]
+    else:
+        dst[k:k + j_end - j] = src[j:j_end]
+    return comparisons
+
+
+def _co_rank(k, src, a_lo, a_len, b_lo, b_len, in_order):
+    """
+    Split point of a stable merge: returns (i, j) with i + j = k such that
+    the first k merged items are exactly A[:i] and B[:j]
+    """
+    lo = max(0, k - b_len)
+    hi = min(k, a_len)
+    
+    while True:
+        i = (lo + hi) // 2
+        j = k - i
+        
+        if i > 0 and j < b_len and not in_order(src[a_lo + i - 1], src[b_lo + j]):
+            hi = i - 1  # Too many from A
+        elif j > 0 and i < a_len and in_order(src[a_lo + i], src[b_lo + j - 1]):
+            lo = i + 1  # Too few from A
+        else:
+            return i, j
+
+
+def _submit_parallel_merge(pool, src, lo, mid, hi, dst, in_order, parts):
+    """Merge src[lo:mid] and src[mid:hi] into dst[lo:hi] as independent co-ranked segments"""
+    a_len = mid - lo
+    b_len = hi - mid
+    total = a_len + b_len
+    
+    splits = [_co_rank(total * p // parts, src, lo, a_len, mid, b_len, in_order)
+              for p in range(parts + 1)]
+    
+    futures = []
+    for p in range(parts):
+        (i0, j0), (i1, j1) = splits[p], splits[p + 1]
+        futures.append(pool.submit(
+            _merge_runs, src, lo + i0, lo + i1, mid + j0, mid + j1, dst, lo + i0 + j0, in_order
+        ))
+    return futures
+
+
 class HeapSort:
     """Heap Sort implementation for comparison"""
     def __init__(self):
@@ -253,41 +561,39 @@ class HeapSort:
             self._heapify(arr, n, largest)
 
 
-def compare_sorting_algorithms(data):
+def compare_sorting_algorithms(data, repeats=5):
     """
     Compare performance of different sorting algorithms
+    Every algorithm sorts the same {genre: score} input; times are medians of repeats
+    (see benchmarks/sorting_benchmark.py for the full suite)
     """
-    import copy
+    def run(sorter, sort_once):
+        times = []
+        result = None
+        for _ in range(repeats):
+            result = sort_once()
+            times.append(sorter.execution_time)
+        times.sort()
+        return {
+            'time': times[len(times) // 2],
+            'comparisons': sorter.comparison_count,
+            'result': result
+        }
     
-    # QuickSort
+    # QuickSort (comparison path, so the counts are comparable)
     qs = QuickSort()
-    qs_data = copy.deepcopy(data)
-    qs_result = qs.sort_by_score(qs_data)
+    quicksort = run(qs, lambda: qs.sort_by_score(data, allow_radix=False))
     
     # MergeSort
     ms = MergeSort()
-    ms_data = copy.deepcopy(data)
-    ms_result = ms.sort_by_distance(ms_data)
+    mergesort = run(ms, lambda: ms.sort_by_distance(data, allow_radix=False))
     
-    # HeapSort
+    # HeapSort on the same pairs, keyed by score
     hs = HeapSort()
-    hs_data = list(data.values())
-    hs_result = hs.sort(hs_data)
+    heapsort = run(hs, lambda: [genre for _, genre in hs.sort([(score, genre) for genre, score in data.items()])])
     
     return {
-        'quicksort': {
-            'time': qs.execution_time,
-            'comparisons': qs.comparison_count,
-            'result': qs_result
-        },
-        'mergesort': {
-            'time': ms.execution_time,
-            'comparisons': ms.comparison_count,
-            'result': ms_result
-        },
-        'heapsort': {
-            'time': hs.execution_time,
-            'comparisons': hs.comparison_count,
-            'result': hs_result
-        }
-    }
\ No newline at end of file
+        'quicksort': quicksort,
+        'mergesort': mergesort,
+        'heapsort': heapsort
+    }
@@ -0,0 +1,163 @@
+"""
+JSON Benchmark Suite
+Times parsing /api/recommend payloads and serializing their responses, separately
+Run this from the backend folder: python -m benchmarks.json_benchmark --help
+"""
+
+import sys
+import json
+import time
+import random
+import argparse
+import statistics
+
+from data_structures.song_table import SongTable
+from utils import json_io
+from benchmarks.sorting_benchmark import percentile, write_results
+
+DEFAULT_SIZES = [10 ** 3, 10 ** 4]
+GENRES = ['Pop', 'Rock', 'Jazz', 'Hip-Hop/Rap', 'Country', 'Electronic', 'R&B/Soul', 'Classical',
+          'Alternative', 'Reggae', 'Metal', 'Blues', 'Latin', 'Folk', 'Dance', 'Soundtrack']
+
+
+# ==========================================
+# INPUT GENERATORS
+# ==========================================
+def generate_payload(n, rng):
+    """A /api/recommend body with n songs (80% playlist, 20% recommendations), iTunes-like fields"""
+    def song(i):
+        return {
+            'id': 100000 + i,
+            'title': f'Track {i}',
+            'artist': f'Artist {rng.randrange(max(1, n // 8))}',
+            'album': f'Album {rng.randrange(max(1, n // 4))}',
+            'genre': rng.choice(GENRES),
+            'price': rng.choice([0.69, 0.99, 1.29]),
+            'duration': rng.randrange(120000, 420000),
+            'releaseDate': f'20{rng.randrange(10, 25)}-0{rng.randrange(1, 10)}-1{rng.randrange(0, 10)}T07:00:00Z',
+            'artwork': f'https://is1-ssl.mzstatic.com/image/thumb/{i}/100x100bb.jpg',
+            'preview': f'https://audio-ssl.itunes.apple.com/preview/{i}.m4a'
+        }
+
+    split = n * 4 // 5
+    return {
+        'playlist': [song(i) for i in range(split)],
+        'recommendations': [song(i) for i in range(split, n)],
+        'users': []
+    }
+
+
+def generate_response(genres, rng):
+    """A response shaped like /api/recommend's, with a complete graph over `genres` genres"""
+    names = [f'Genre {i}' for i in range(genres)]
+    counts = {name: rng.randrange(1, 50) for name in names}
+    adjacency = {
+        a: [{'to': b, 'weight': 1 + abs(counts[a] - counts[b])} for b in names if b != a]
+        for a in names
+    }
+    edges = [{'from': a, 'to': e['to'], 'weight': e['weight']}
+             for a in names for e in adjacency[a] if a < e['to']]
+    scores = {name: round(rng.uniform(0, 100), 2) for name in names}
+    return {
+        'success': True,
+        'orderedGenres': sorted(scores, key=scores.get, reverse=True),
+        'genreCounts': counts,
+        'recommendationScores': scores,
+        'distances': {name: round(rng.uniform(0, 10), 2) for name in names},
+        'graphStructure': {'nodes': names, 'edges': edges, 'adjacency_list': adjacency, 'density': 1.0}
+    }
+
+
+# ==========================================
+# CASES
+# Each is (group, name, prepare(payload, response) -> input, run(input))
+# ==========================================
+def _parse_into_table(raw):
+    data = json_io.loads(raw)
+    return SongTable.from_payload(data['playlist'], data['recommendations'])
+
+def _stdlib_flask_dumps(obj):
+    # What jsonify did: sorted keys, compact separators, str then encode
+    return json.dumps(obj, sort_keys=True, separators=(',', ':')).encode('utf-8')
+
+CASES = [
+    ('parse', 'json.loads', lambda p, r: json.dumps(p).encode('utf-8'),
+     lambda raw: json.loads(raw.decode('utf-8'))),
+    ('parse', f'json_io.loads ({json_io.BACKEND})', lambda p, r: json.dumps(p).encode('utf-8'),
+     json_io.loads),
+    ('parse', 'json_io.loads + SongTable', lambda p, r: json.dumps(p).encode('utf-8'),
+     _parse_into_table),
+    ('serialize', 'json.dumps', lambda p, r: r, _stdlib_flask_dumps),
+    ('serialize', f'json_io.dumps ({json_io.BACKEND})', lambda p, r: r, json_io.dumps),
+    ('serialize', 'json_io.iter_dumps', lambda p, r: r, lambda obj: b''.join(json_io.iter_dumps(obj))),
+]
+
+
+# ==========================================
+# HARNESS
+# ==========================================
+def benchmark_case(run, value, repeats, warmup):
+    """Time one case on one prepared input"""
+    for _ in range(warmup):
+        run(value)
+
+    times = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        run(value)
+        times.append(time.perf_counter() - start)
+
+    times.sort()
+    return {
+        'median_s': statistics.median(times),
+        'p95_s': percentile(times, 0.95),
+        'min_s': times[0],
+    }
+
+
+def run_suite(sizes, genres, repeats, warmup, seed):
+    """Run every case for every payload size, returns a list of result rows"""
+    results = []
+    rng = random.Random(seed)
+
+    for n in sizes:
+        payload = generate_payload(n, rng)
+        response = generate_response(genres, rng)
+
+        for group, name, prepare, run in CASES:
+            value = prepare(payload, response)
+            row = {'group': group, 'case': name, 'songs': n, 'genres': genres,
+                   'bytes': len(value) if isinstance(value, bytes) else len(_stdlib_flask_dumps(value)),
+                   'repeats': repeats}
+            row.update(benchmark_case(run, value, repeats, warmup))
+            results.append(row)
+            print(f"  {group:>9} n={n:<7} {name:<32} "
+                  f"median {row['median_s']:.6f}s  p95 {row['p95_s']:.6f}s", file=sys.stderr)
+
+    return results
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Benchmark JSON parse and serialize of recommendation payloads")
+    parser.add_argument('--sizes', default=','.join(str(n) for n in DEFAULT_SIZES),
+                        help="comma separated payload sizes in songs")
+    parser.add_argument('--genres', type=int, default=200, help="genres in the serialized response graph")
+    parser.add_argument('--repeats', type=int, default=10)
+    parser.add_argument('--warmup', type=int, default=2)
+    parser.add_argument('--seed', type=int, default=42)
+    parser.add_argument('--format', choices=['json', 'csv'], default='json')
+    parser.add_argument('--output', help="write results here instead of stdout")
+    args = parser.parse_args(argv)
+
+    results = run_suite(
+        [int(n) for n in args.sizes.split(',') if n],
+        args.genres,
+        args.repeats,
+        args.warmup,
+        args.seed,
+    )
+    write_results(results, args.format, args.output)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,188 @@
+"""
+Sorting Benchmark Suite
+Times every sorting engine on realistic score distributions
+Run this from the backend folder: python -m benchmarks.sorting_benchmark --help
+"""
+
+import sys
+import csv
+import json
+import time
+import random
+import argparse
+import statistics
+
+from algorithms.sorting import QuickSort, MergeSort, HeapSort
+from algorithms.radix_sort import radix_sort_pairs
+
+DEFAULT_SIZES = [10 ** 2, 10 ** 3, 10 ** 4, 10 ** 5]
+DISTRIBUTIONS = ['random', 'sorted', 'reverse', 'few_unique', 'zipf']
+
+
+# ==========================================
+# INPUT GENERATORS
+# ==========================================
+def generate_scores(distribution, n, rng):
+    """
+    Two-decimal scores like the ones MusicAnalyzer produces
+    'sorted' is already in ranking order (highest first), 'reverse' is lowest first
+    """
+    if distribution == 'random':
+        values = [round(rng.uniform(0, 100), 2) for _ in range(n)]
+    elif distribution == 'sorted':
+        values = sorted((round(rng.uniform(0, 100), 2) for _ in range(n)), reverse=True)
+    elif distribution == 'reverse':
+        values = sorted(round(rng.uniform(0, 100), 2) for _ in range(n))
+    elif distribution == 'few_unique':
+        choices = [1.0, 2.0, 3.0, 5.0]  # Many genres tying on the same score
+        values = [rng.choice(choices) for _ in range(n)]
+    elif distribution == 'zipf':
+        # A handful of very popular scores, long tail of rare ones
+        distinct = [round(100 / rank, 2) for rank in range(1, 1001)]
+        weights = [1 / rank ** 1.1 for rank in range(1, 1001)]
+        values = rng.choices(distinct, weights=weights, k=n)
+    else:
+        raise ValueError(f"Unknown distribution: {distribution}")
+
+    return {f'genre_{i}': value for i, value in enumerate(values)}
+
+
+# ==========================================
+# ENGINES
+# Every engine does the same ranking task: genres by score, highest first
+# Each returns the number of comparisons made (None when not counted)
+# ==========================================
+def run_quicksort(scores):
+    sorter = QuickSort()
+    sorter.sort_by_score(scores, allow_radix=False)
+    return sorter.comparison_count
+
+def run_mergesort(scores):
+    sorter = MergeSort()
+    sorter.sort_by_count(scores, allow_radix=False)
+    return sorter.comparison_count
+
+def run_heapsort(scores):
+    sorter = HeapSort()
+    sorter.sort([(-score, genre) for genre, score in scores.items()])  # Ascending on -score
+    return sorter.comparison_count
+
+def run_radix(scores):
+    radix_sort_pairs(list(scores.values()), list(scores.keys()), descending=True)
+    return 0
+
+def run_builtin(scores):
+    sorted(scores, key=scores.get, reverse=True)
+    return None
+
+ENGINES = {
+    'quicksort': run_quicksort,
+    'mergesort': run_mergesort,
+    'heapsort': run_heapsort,
+    'radix': run_radix,
+    'builtin': run_builtin,
+}
+
+
+# ==========================================
+# HARNESS
+# ==========================================
+def percentile(sorted_values, fraction):
+    """Nearest-rank percentile of an already sorted list"""
+    index = max(0, min(len(sorted_values) - 1, int(round(fraction * len(sorted_values) + 0.5)) - 1))
+    return sorted_values[index]
+
+
+def benchmark_case(engine, scores, repeats, warmup):
+    """Time one engine on one input; each run gets its own copy of the input"""
+    run = ENGINES[engine]
+
+    for _ in range(warmup):
+        run(dict(scores))
+
+    times = []
+    comparisons = None
+    for _ in range(repeats):
+        data = dict(scores)
+        start = time.perf_counter()
+        comparisons = run(data)
+        times.append(time.perf_counter() - start)
+
+    times.sort()
+    n = len(scores)
+    return {
+        'median_s': statistics.median(times),
+        'p95_s': percentile(times, 0.95),
+        'min_s': times[0],
+        'comparisons': comparisons,
+        'comparisons_per_element': (comparisons / n) if comparisons is not None and n else None,
+    }
+
+
+def run_suite(engines, distributions, sizes, repeats, warmup, seed):
+    """Run every (distribution, size, engine) combination, returns a list of result rows"""
+    results = []
+    rng = random.Random(seed)
+
+    for distribution in distributions:
+        for n in sizes:
+            scores = generate_scores(distribution, n, rng)
+
+            for engine in engines:
+                row = {'engine': engine, 'distribution': distribution, 'n': n,
+                       'repeats': repeats}
+                row.update(benchmark_case(engine, scores, repeats, warmup))
+                results.append(row)
+                print(f"  {distribution:>10} n={n:<9} {engine:<10} "
+                      f"median {row['median_s']:.6f}s  p95 {row['p95_s']:.6f}s", file=sys.stderr)
+
+    return results
+
+
+def write_results(results, fmt, output):
+    """Write results as JSON or CSV to a file (or stdout)"""
+    stream = open(output, 'w', newline='') if output else sys.stdout
+    try:
+        if fmt == 'csv':
+            writer = csv.DictWriter(stream, fieldnames=list(results[0].keys()) if results else [])
+            writer.writeheader()
+            writer.writerows(results)
+        else:
+            json.dump({'results': results}, stream, indent=2)
+            stream.write('\n')
+    finally:
+        if output:
+            stream.close()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Benchmark the sorting engines used for ranking")
+    parser.add_argument('--engines', default=','.join(ENGINES), help="comma separated engine names")
+    parser.add_argument('--distributions', default=','.join(DISTRIBUTIONS))
+    parser.add_argument('--sizes', default=','.join(str(n) for n in DEFAULT_SIZES),
+                        help="comma separated input sizes (up to 10000000)")
+    parser.add_argument('--repeats', type=int, default=5)
+    parser.add_argument('--warmup', type=int, default=1)
+    parser.add_argument('--seed', type=int, default=42)
+    parser.add_argument('--format', choices=['json', 'csv'], default='json')
+    parser.add_argument('--output', help="write results here instead of stdout")
+    args = parser.parse_args(argv)
+
+    engines = [e for e in args.engines.split(',') if e]
+    unknown = [e for e in engines if e not in ENGINES]
+    if unknown:
+        parser.error(f"unknown engines: {', '.join(unknown)}")
+
+    results = run_suite(
+        engines,
+        [d for d in args.distributions.split(',') if d],
+        [int(n) for n in args.sizes.split(',') if n],
+        args.repeats,
+        args.warmup,
+        args.seed,
+    )
+    write_results(results, args.format, args.output)
+
+
+if __name__ == '__main__':
+    main()
@@ -42,6 +42,46 @@ class ArtistBST:
         else:
             node.count = count
     
+    def delete(self, artist, count):
+        """Delete an artist stored with the given count"""
+        parent, node = None, self.root
+        
+        # Same ordering as insert: count first, then artist name
+        while node and (node.count, node.artist) != (count, artist):
+            parent = node
+            if count < node.count or (count == node.count and artist < node.artist):
+                node = node.left
+            else:
+                node = node.right
+        
+        if not node:
+            return False
+        
+        # Two children: take the inorder successor's key, then unlink the successor
+        if node.left and node.right:
+            successor_parent, successor = node, node.right
+            while successor.left:
+                successor_parent, successor = successor, successor.left
+            node.artist, node.count = successor.artist, successor.count
+            parent, node = successor_parent, successor
+        
+        child = node.left or node.right
+        if not parent:
+            self.root = child
+        elif parent.left is node:
+            parent.left = child
+        else:
+            parent.right = child
+        
+        self._size -= 1
+        return True
+    
+    def update_count(self, artist, old_count, new_count):
+        """Move an artist to a new count (count 0 removes it)"""
+        self.delete(artist, old_count)
+        if new_count > 0:
+            self.insert(artist, new_count)
+    
     def search(self, artist):
         """Search for an artist"""
         return self._search_helper(self.root, artist)
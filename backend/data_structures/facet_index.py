@@ -0,0 +1,105 @@
+"""
+Facet Index - Bitmap Postings for Product Filters
+One roaring bitmap of catalog rows per facet value, built once per catalog load
+"""
+
+import math
+import bisect
+from collections import defaultdict
+
+from data_structures.roaring_bitmap import RoaringBitmap
+
+class FacetIndex:
+    """
+    Facets and their values:
+        category, brand  - catalog labels
+        price            - bucket labels from PRICE_BUCKETS ('0-10', ..., '1000+')
+        rating           - whole stars, '0' to '5' ('4' holds ratings in [4, 5))
+        in_stock         - 'true' when stock > 0, else 'false'
+    Values of one facet are ORed and facets are ANDed, so any filter is a few bitmap operations
+    """
+    FACETS = ('category', 'brand', 'price', 'rating', 'in_stock')
+    PRICE_BUCKETS = (10, 25, 50, 100, 250, 500, 1000)
+
+    def __init__(self, catalog):
+        self.rows = len(catalog)
+        self.all = RoaringBitmap.from_sorted(range(self.rows))
+
+        postings = {facet: defaultdict(list) for facet in self.FACETS}
+        for facet in ('category', 'brand'):
+            for row, label in enumerate(catalog.labels(facet)):
+                if label is not None:
+                    postings[facet][label].append(row)
+
+        for row in range(self.rows):
+            price = catalog.field(row, 'price')
+            if isinstance(price, (int, float)) and not isinstance(price, bool):
+                postings['price'][self.price_bucket(price)].append(row)
+            rating = catalog.field(row, 'rating')
+            if isinstance(rating, (int, float)) and not isinstance(rating, bool):
+                postings['rating'][self.rating_bucket(rating)].append(row)
+            stock = catalog.field(row, 'stock')
+            if isinstance(stock, (int, float)) and not isinstance(stock, bool):
+                postings['in_stock']['true' if stock > 0 else 'false'].append(row)
+
+        self.bitmaps = {
+            facet: {value: RoaringBitmap.from_sorted(rows) for value, rows in values.items()}
+            for facet, values in postings.items()
+        }
+
+        # Lowercased titles for substring search (not a facet: matched rows become a bitmap per query)
+        self.titles = [(title or '').lower() for title in catalog.labels('title')]
+
+    @classmethod
+    def price_bucket(cls, price):
+        index = bisect.bisect_right(cls.PRICE_BUCKETS, price)
+        if index == len(cls.PRICE_BUCKETS):
+            return f'{cls.PRICE_BUCKETS[-1]}+'
+        low = cls.PRICE_BUCKETS[index - 1] if index else 0
+        return f'{low}-{cls.PRICE_BUCKETS[index]}'
+
+    @staticmethod
+    def rating_bucket(rating):
+        return str(min(5, max(0, math.floor(rating))))
+
+    def ratings_at_least(self, stars):
+        """Rating bucket labels for a minimum whole-star rating"""
+        return [value for value in self.bitmaps['rating'] if int(value) >= stars]
+
+    def values_bitmap(self, facet, values):
+        """Rows having any of the values (OR)"""
+        postings = self.bitmaps[facet]
+        return RoaringBitmap.union_all(postings[value] for value in values if value in postings)
+
+    def search(self, term):
+        """Rows whose title contains the term (case-insensitive)"""
+        term = term.lower()
+        return RoaringBitmap.from_sorted(row for row, title in enumerate(self.titles) if term in title)
+
+    def filter(self, selected, extra=(), exclude=None):
+        """
+        Rows matching every selected facet ({facet: [values]}) and every bitmap in `extra`
+        `exclude` leaves one facet out (used for that facet's own counts)
+        """
+        bitmaps = [self.values_bitmap(facet, values)
+                   for facet, values in selected.items() if facet != exclude]
+        bitmaps.extend(extra)
+        result = RoaringBitmap.intersect_all(bitmaps)
+        return self.all if result is None else result
+
+    def counts(self, selected, extra=()):
+        """
+        {facet: {value: rows}} for the current filter
+        Each facet is counted without its own selection, so the other values of a selected facet
+        still show how many rows choosing them would add
+        """
+        result = {}
+        for facet in self.FACETS:
+            base = self.filter(selected, extra, exclude=facet)
+            counts = {}
+            for value, bitmap in self.bitmaps[facet].items():
+                count = len(bitmap & base) if base is not self.all else len(bitmap)
+                if count:
+                    counts[value] = count
+            result[facet] = counts
+        return result
@@ -0,0 +1,185 @@
+"""
+Song Feature Store - Cached Vector Implementation
+Computes a stable, normalized feature vector once per song and serves it from one contiguous buffer
+"""
+
+import zlib
+import math
+import heapq
+import threading
+from array import array
+
+class SongFeatureStore:
+    """
+    Vector layout (all values in [0, 1]):
+    [genre one-hot (hashed) | artist one-hot (hashed) | price | audio attributes...]
+    """
+    # attribute -> value that maps to 1.0 (larger values are clamped)
+    DEFAULT_AUDIO_ATTRIBUTES = {
+        'duration': 600000  # 10 minutes in milliseconds
+    }
+
+    def __init__(self, genre_buckets=32, artist_buckets=64, max_price=2.0,
+                 audio_attributes=None, genre_weight=1.0, artist_weight=0.5,
+                 capacity=100000):
+        self.genre_buckets = genre_buckets
+        self.artist_buckets = artist_buckets
+        self.max_price = max_price
+        self.audio_attributes = dict(self.DEFAULT_AUDIO_ATTRIBUTES if audio_attributes is None
+                                     else audio_attributes)
+        self.genre_weight = genre_weight
+        self.artist_weight = artist_weight
+        self.capacity = capacity  # Songs kept before the store resets (~80 MB at the default dimension)
+
+        self.dimension = genre_buckets + artist_buckets + 1 + len(self.audio_attributes)
+        # One generation: (song key -> row index, row-major buffer of dimension values per song)
+        # clear() swaps in a new pair, so a reader holding the old one never mixes a row from one
+        # generation with the buffer of another
+        self._generation = ({}, array('d'))
+        self._lock = threading.Lock()  # Row assignment must not interleave between threads
+        self.hits = 0
+        self.misses = 0
+
+    def song_key(self, song):
+        """Identity of a song: its id, falling back to its descriptive fields"""
+        song_id = song.get('id')
+        if song_id is not None:
+            return song_id
+        return (song.get('title'), song.get('artist'), song.get('genre'), song.get('album'))
+
+    def cache_key(self, song):
+        """
+        Cache key of a song: its identity plus every field its vector is built from, so a
+        song id reused with a different genre, artist, price or attribute gets a fresh vector
+        """
+        return self._key(self.song_key(song), song.get('genre'), song.get('artist'), song.get('price', 0),
+                         tuple(song.get(name, 0) for name in self.audio_attributes))
+
+    @staticmethod
+    def _key(*parts):
+        try:
+            hash(parts)
+            return parts
+        except TypeError:  # Malformed payload fields (lists, dicts) still get a stable key
+            return repr(parts)
+
+    def _bucket(self, value, buckets):
+        """Stable hash bucket (crc32 does not change between processes like hash() does)"""
+        return zlib.crc32(str(value).encode('utf-8')) % buckets
+
+    def _encode(self, genre, artist, price, attribute):
+        """Build the normalized vector from raw field values (attribute(name) -> number)"""
+        vector = [0.0] * self.dimension
+
+        vector[self._bucket(genre or 'Unknown', self.genre_buckets)] = self.genre_weight
+        vector[self.genre_buckets + self._bucket(artist or 'Unknown', self.artist_buckets)] = self.artist_weight
+
+        offset = self.genre_buckets + self.artist_buckets
+        price = float(price or 0)
+        vector[offset] = min(max(price, 0.0), self.max_price) / self.max_price
+
+        for i, (name, scale) in enumerate(self.audio_attributes.items(), start=1):
+            value = float(attribute(name) or 0)
+            vector[offset + i] = min(max(value, 0.0), scale) / scale
+
+        return vector
+
+    def _compute(self, song):
+        """Build the normalized vector for one song dict"""
+        return self._encode(song.get('genre'), song.get('artist'), song.get('price', 0),
+                            lambda name: song.get(name, 0))
+
+    def _vector_for(self, key, compute):
+        """Cached vector for a key (a copy), calling compute() for it on first sight"""
+        row_of, vectors = self._generation
+        row = row_of.get(key)
+
+        if row is not None:
+            self.hits += 1
+            start = row * self.dimension
+            return vectors[start:start + self.dimension]
+
+        vector = compute()
+        with self._lock:
+            row_of, vectors = self._generation
+            if key in row_of:
+                start = row_of[key] * self.dimension
+                return vectors[start:start + self.dimension]
+
+            self.misses += 1
+            if len(row_of) >= self.capacity:
+                self.clear()
+                row_of, vectors = self._generation
+
+            start = len(row_of) * self.dimension
+            vectors.extend(vector)
+            row_of[key] = len(row_of)  # Published after its values are in the buffer
+            return vectors[start:start + self.dimension]
+
+    def encode(self, song):
+        """Vector of a song computed directly, without reading or filling the cache"""
+        return self._compute(song)
+
+    def vector(self, song):
+        """Feature vector of a single song"""
+        return self._vector_for(self.cache_key(song), lambda: self._compute(song))
+
+    def vectors_for(self, songs):
+        """Feature vectors for a list of songs, in order"""
+        return [self.vector(song) for song in songs]
+
+    def vectors_for_table(self, table):
+        """Feature vectors for every row of a SongTable, read from its columns"""
+        vectors = []
+        numeric = table.numbers
+
+        for row in range(len(table)):
+            genre, artist, price = table.value('genre', row), table.value('artist', row), numeric['price'][row]
+            attributes = tuple(numeric[name][row] if name in numeric else 0 for name in self.audio_attributes)
+            compute = lambda: self._encode(genre, artist, price,
+                                           dict(zip(self.audio_attributes, attributes)).get)
+            key = self._key(table.song_key(row), genre, artist, price, attributes)
+            vectors.append(self._vector_for(key, compute))
+
+        return vectors
+
+    def distance(self, song1, song2):
+        """Euclidean distance between two cached songs"""
+        # Each vector is copied from a consistent generation, so a clear() in between is harmless
+        return math.dist(self.vector(song1), self.vector(song2))
+
+    def nearest(self, target_song, candidates, top_k=5):
+        """
+        Find the top_k candidates closest to target_song
+        Returns list of (distance, song) tuples, closest first
+        """
+        target_key = self.song_key(target_song)
+        scored = (
+            (self.distance(target_song, song), index, song)
+            for index, song in enumerate(candidates)
+            if self.song_key(song) != target_key
+        )
+        return [(distance, song) for distance, _, song in heapq.nsmallest(top_k, scored)]
+
+    def size(self):
+        """Number of cached songs"""
+        return len(self._generation[0])
+
+    def clear(self):
+        """Drop every cached vector (readers of the previous generation keep a consistent copy)"""
+        self._generation = ({}, array('d'))
+
+    def get_statistics(self):
+        """Get statistics about the store"""
+        row_of, vectors = self._generation
+        return {
+            'songs': len(row_of),
+            'dimension': self.dimension,
+            'bytes': vectors.itemsize * len(vectors),
+            'hits': self.hits,
+            'misses': self.misses
+        }
+
+
+# Shared by clustering and similarity search so vectors are computed once per process
+default_feature_store = SongFeatureStore()
@@ -39,20 +39,77 @@ class MusicGraph:
             self.genre_counts[genre] += 1
             self.add_node(genre)
     
-    def build_genre_graph(self, playlist, recommendations):
+    def add_genre_counts(self, genre_counts):
+        """Bulk version of add_song from precomputed {genre: songs} counts"""
+        for genre, count in genre_counts.items():
+            self.genre_counts[genre] += count
+            self.add_node(genre)
+    
+    def set_genre_count(self, genre, count):
+        """
+        Change one genre's count and re-weight only its edges (Weight = 1 + |count_difference|)
+        Count 0 removes the genre; a new genre is connected to every existing one
+        """
+        if count <= 0:
+            self.remove_node(genre)
+            return
+        
+        self.genre_counts[genre] = count
+        if genre not in self.nodes:
+            for other in list(self.nodes):
+                weight = 1 + abs(count - self.genre_counts[other])
+                self.add_edge(genre, other, weight)
+                self.add_edge(other, genre, weight)
+            self.add_node(genre)
+            return
+        
+        for edge in self.adjacency_list[genre]:
+            weight = 1 + abs(count - self.genre_counts[edge['to']])
+            edge['weight'] = weight
+            for back in self.adjacency_list[edge['to']]:
+                if back['to'] == genre:
+                    back['weight'] = weight
+                    break
+    
+    def copy(self):
+        """Independent copy (edges are copied too, so weights can be changed on either)"""
+        graph = MusicGraph()
+        graph.nodes = set(self.nodes)
+        graph.genre_counts = Counter(self.genre_counts)
+        for node, edges in self.adjacency_list.items():
+            graph.adjacency_list[node] = [dict(edge) for edge in edges]
+        return graph
+    
+    def remove_node(self, node):
+        """Remove a genre and every edge touching it"""
+        if node not in self.nodes:
+            return
+        
+        for edge in self.adjacency_list.pop(node, []):
+            self.adjacency_list[edge['to']] = [
+                back for back in self.adjacency_list[edge['to']] if back['to'] != node
+            ]
+        self.nodes.discard(node)
+        self.genre_counts.pop(node, None)
+    
+    def build_genre_graph(self, playlist, recommendations, aggregate=None):
         """
         Build a complete weighted graph of genres
         Weight = 1 + |count_difference|
         """
-        # Count genres from playlist (weight 1)
-        for song in playlist:
-            if song.get('genre'):
-                self.genre_counts[song['genre']] += 1
-        
-        # Count genres from recommendations (weight 2)
-        for song in recommendations:
-            if song.get('genre'):
-                self.genre_counts[song['genre']] += 2
+        if aggregate is not None:
+            # Weighted counts already computed in the shared aggregation pass
+            self.genre_counts.update(aggregate.genre_counts)
+        else:
+            # Count genres from playlist (weight 1)
+            for song in playlist:
+                if song.get('genre'):
+                    self.genre_counts[song['genre']] += 1
+            
+            # Count genres from recommendations (weight 2)
+            for song in recommendations:
+                if song.get('genre'):
+                    self.genre_counts[song['genre']] += 2
         
         genres = list(self.genre_counts.keys())
         
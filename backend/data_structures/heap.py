@@ -96,6 +96,23 @@ class RecommendationHeap:
         else:
             self._heapify_down(index)
     
+    def remove(self, genre):
+        """Remove a genre from the heap"""
+        if genre not in self.genre_map:
+            return False
+        
+        index = self.genre_map.pop(genre)
+        last = self.heap.pop()
+        
+        # Fill the hole with the last element and restore the heap property
+        if index < len(self.heap):
+            self.heap[index] = last
+            self.genre_map[last['genre']] = index
+            self._heapify_up(index)
+            self._heapify_down(self.genre_map[last['genre']])
+        
+        return True
+    
     def size(self):
         """Return the number of elements in the heap"""
         return len(self.heap)
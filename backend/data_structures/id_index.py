@@ -0,0 +1,98 @@
+"""
+Id Index - Integer Id to Row Lookup
+Built once per catalog load so product lookups cost O(1) regardless of catalog size
+"""
+
+from array import array
+
+class IdIndex:
+    """
+    Maps integer ids to row numbers (the first row wins for a duplicate id)
+    Dense mode:  ids fit in a range at most DENSE_FACTOR times the row count, so rows are
+                 stored in a direct array indexed by id - min_id
+    Hash mode:   open addressing with linear probing over two flat arrays (keys, rows),
+                 kept at most half full; Fibonacci hashing spreads sequential ids
+    """
+    DENSE_FACTOR = 4
+    EMPTY_ROW = -1
+    EMPTY_KEY = -(1 << 63)  # Also the catalog's missing-id sentinel, which is never indexed
+    GOLDEN = 0x9E3779B97F4A7C15  # 2^64 / golden ratio
+
+    def __init__(self, ids):
+        """ids: one id per row (None or EMPTY_KEY for a row without an integer id)"""
+        indexed = [(row, value) for row, value in enumerate(ids)
+                   if value is not None and value != self.EMPTY_KEY]
+        self.count = 0
+        self.min_id = min((value for _, value in indexed), default=0)
+        span = max((value for _, value in indexed), default=0) - self.min_id + 1
+
+        if span <= max(1, len(indexed)) * self.DENSE_FACTOR:
+            self.mode = 'dense'
+            self.rows = array('q', [self.EMPTY_ROW]) * span
+            self.keys = None
+        else:
+            self.mode = 'hash'
+            capacity = 1
+            while capacity < 2 * len(indexed):
+                capacity <<= 1
+            self.bits = capacity.bit_length() - 1
+            self.mask = capacity - 1
+            self.keys = array('q', [self.EMPTY_KEY]) * capacity
+            self.rows = array('q', [self.EMPTY_ROW]) * capacity
+
+        for row, value in indexed:
+            self._insert(value, row)
+
+    def _slot(self, value):
+        """Home slot of an id: the top `bits` bits of id * GOLDEN (mod 2^64)"""
+        return ((value * self.GOLDEN) & 0xFFFFFFFFFFFFFFFF) >> (64 - self.bits) if self.bits else 0
+
+    def _insert(self, value, row):
+        if self.mode == 'dense':
+            if self.rows[value - self.min_id] == self.EMPTY_ROW:
+                self.rows[value - self.min_id] = row
+                self.count += 1
+            return
+
+        slot = self._slot(value)
+        while self.keys[slot] != self.EMPTY_KEY:
+            if self.keys[slot] == value:
+                return
+            slot = (slot + 1) & self.mask
+        self.keys[slot] = value
+        self.rows[slot] = row
+        self.count += 1
+
+    def get(self, value, default=None):
+        """Row of an id, or default"""
+        if self.mode == 'dense':
+            offset = value - self.min_id
+            if 0 <= offset < len(self.rows):
+                row = self.rows[offset]
+                if row != self.EMPTY_ROW:
+                    return row
+            return default
+
+        if value == self.EMPTY_KEY:
+            return default
+        slot = self._slot(value)
+        while True:
+            key = self.keys[slot]
+            if key == value:
+                return self.rows[slot]
+            if key == self.EMPTY_KEY:
+                return default
+            slot = (slot + 1) & self.mask
+
+    def __contains__(self, value):
+        return self.get(value) is not None
+
+    def __len__(self):
+        return self.count
+
+    def memory_bytes(self):
+        """Size of the index arrays"""
+        size = self.rows.itemsize * len(self.rows)
+        if self.keys is not None:
+            size += self.keys.itemsize * len(self.keys)
+        return size
@@ -0,0 +1,138 @@
+"""
+MinHash + LSH Index
+Finds playlists similar to a query playlist without comparing it against every user
+"""
+
+import zlib
+import random
+import threading
+
+MERSENNE_PRIME = (1 << 61) - 1
+MAX_HASH = (1 << 32) - 1
+
+class PlaylistLSHIndex:
+    """
+    Each playlist becomes a token set (genres, artists, tracks) and a MinHash signature
+    The signature is cut into bands; playlists sharing any whole band land in the same
+    bucket and become candidates, which are then re-ranked by exact Jaccard similarity
+    """
+    def __init__(self, num_perm=128, bands=32, seed=7):
+        if num_perm % bands != 0:
+            raise ValueError("num_perm must be a multiple of bands")
+
+        self.num_perm = num_perm
+        self.bands = bands
+        self.rows = num_perm // bands
+
+        # One (a, b) pair per permutation: h(x) = (a * x + b) mod p
+        rng = random.Random(seed)
+        self._a = [rng.randint(1, MERSENNE_PRIME - 1) for _ in range(num_perm)]
+        self._b = [rng.randint(0, MERSENNE_PRIME - 1) for _ in range(num_perm)]
+
+        self.buckets = [{} for _ in range(bands)]  # band -> {band key: set(user ids)}
+        self.signatures = {}  # user id -> signature
+        self.token_sets = {}  # user id -> token set (for exact re-ranking)
+        self._lock = threading.Lock()  # Guards the three maps; signatures are hashed outside it
+
+    @staticmethod
+    def tokens(playlist):
+        """Token set of a playlist: genres, artists and track ids"""
+        tokens = set()
+        for song in playlist:
+            if song.get('genre'):
+                tokens.add('g:' + str(song['genre']))
+            if song.get('artist'):
+                tokens.add('a:' + str(song['artist']))
+            if song.get('id') is not None:
+                tokens.add('t:' + str(song['id']))
+        return tokens
+
+    def signature(self, tokens):
+        """MinHash signature of a token set"""
+        if not tokens:
+            return [MAX_HASH] * self.num_perm
+
+        hashes = [zlib.crc32(token.encode('utf-8')) for token in tokens]
+        return [
+            min(((a * h + b) % MERSENNE_PRIME) & MAX_HASH for h in hashes)
+            for a, b in zip(self._a, self._b)
+        ]
+
+    def _band_keys(self, signature):
+        """One hashable key per band"""
+        return [tuple(signature[i * self.rows:(i + 1) * self.rows]) for i in range(self.bands)]
+
+    def add(self, user_id, playlist):
+        """Index (or re-index) a user's playlist"""
+        tokens = self.tokens(playlist)
+        signature = self.signature(tokens)
+        band_keys = self._band_keys(signature)
+
+        with self._lock:
+            self._remove(user_id)
+            self.token_sets[user_id] = tokens
+            self.signatures[user_id] = signature
+            for band, key in enumerate(band_keys):
+                self.buckets[band].setdefault(key, set()).add(user_id)
+
+    def remove(self, user_id):
+        """Drop a user from the index"""
+        with self._lock:
+            return self._remove(user_id)
+
+    def _remove(self, user_id):
+        """remove() with the lock held"""
+        signature = self.signatures.pop(user_id, None)
+        if signature is None:
+            return False
+
+        self.token_sets.pop(user_id, None)
+        for band, key in enumerate(self._band_keys(signature)):
+            bucket = self.buckets[band].get(key)
+            if bucket is not None:
+                bucket.discard(user_id)
+                if not bucket:
+                    del self.buckets[band][key]
+        return True
+
+    def query(self, playlist, top_k=10, exclude=None):
+        """
+        Users whose playlists are most similar to the given playlist
+        Returns list of {'user_id', 'similarity'} sorted by exact Jaccard similarity
+        """
+        return self._query_tokens(self.tokens(playlist), top_k, exclude)
+
+    def query_user(self, user_id, top_k=10):
+        """Users similar to an already indexed user"""
+        tokens = self.token_sets.get(user_id)
+        if tokens is None:
+            return []
+        return self._query_tokens(tokens, top_k, exclude=user_id)
+
+    def _query_tokens(self, tokens, top_k, exclude):
+        """Collect LSH candidates, then re-rank them by exact Jaccard similarity"""
+        if not tokens:
+            return []
+
+        band_keys = self._band_keys(self.signature(tokens))
+
+        # Snapshot the candidates' token sets under the lock, re-rank outside it
+        with self._lock:
+            candidates = set()
+            for band, key in enumerate(band_keys):
+                candidates.update(self.buckets[band].get(key, ()))
+            candidates.discard(exclude)
+            others = [(user_id, self.token_sets[user_id]) for user_id in candidates]
+
+        ranked = []
+        for user_id, other in others:
+            union = len(tokens | other)
+            similarity = len(tokens & other) / union if union else 0
+            ranked.append({'user_id': user_id, 'similarity': round(similarity, 4)})
+
+        ranked.sort(key=lambda item: item['similarity'], reverse=True)
+        return ranked[:top_k]
+
+    def size(self):
+        """Number of indexed playlists"""
+        return len(self.signatures)
@@ -0,0 +1,271 @@
+"""
+Product Catalog - Memory-Mapped Columnar Snapshot
+Versioned binary file of fixed-width columns plus a string arena, built offline by
+tools/build_catalog.py and mmap'ed by the shopping server (pages are shared between processes)
+"""
+
+import os
+import sys
+import mmap
+import math
+import struct
+from array import array
+
+from utils import json_io
+
+MAGIC = b'LLPC'
+FORMAT_VERSION = 1
+
+# Header: magic, version, section count, rows, strings
+HEADER = struct.Struct('<4sHHQQ')
+# Section directory entry: name, kind (array typecode), offset, size in bytes
+SECTION = struct.Struct('<24s1s7xQQ')
+ALIGNMENT = 8
+
+# Hot product fields get their own column; everything else (and any value whose type does not
+# match its column) goes into the row's `_extra` JSON document in the string arena
+COLUMNS = (
+    ('id', 'q'),
+    ('price', 'd'),
+    ('discountPercentage', 'd'),
+    ('rating', 'd'),
+    ('stock', 'q'),
+    ('title', 'I'),
+    ('category', 'I'),
+    ('brand', 'I'),
+    ('thumbnail', 'I'),
+    ('availabilityStatus', 'I'),
+)
+EXTRA = '_extra'
+_KINDS = dict(COLUMNS)
+
+# Sentinels for a missing value (the key is left out of the product)
+MISSING_INT = -(1 << 63)
+MISSING_STRING = 0xFFFFFFFF
+
+_TYPES = {'q': int, 'd': float, 'I': str}
+_ITEM_SIZES = {kind: array(kind).itemsize for kind in ('q', 'd', 'I', 'Q', 'B')}
+_REQUIRED_SECTIONS = [name for name, _ in COLUMNS] + [EXTRA, '_string_offsets', '_string_arena']
+
+
+def _fits(kind, value):
+    """True if the value round-trips exactly through a column of this kind"""
+    if type(value) is not _TYPES[kind]:
+        return False
+    if kind == 'q':
+        return MISSING_INT < value < (1 << 63)
+    if kind == 'd':
+        return not math.isnan(value)
+    return True
+
+
+def build_catalog_bytes(products):
+    """Encode a list of product dicts into the catalog format"""
+    strings, string_ids = [], {}
+
+    def intern(value):
+        string_id = string_ids.get(value)
+        if string_id is None:
+            string_id = string_ids[value] = len(strings)
+            strings.append(value)
+        return string_id
+
+    columns = {name: array(kind) for name, kind in COLUMNS}
+    columns[EXTRA] = array('I')
+    missing = {'q': MISSING_INT, 'd': math.nan, 'I': MISSING_STRING}
+
+    for product in products:
+        extra = dict(product)
+        for name, kind in COLUMNS:
+            value = product.get(name)
+            if name in product and _fits(kind, value):
+                del extra[name]
+                columns[name].append(intern(value) if kind == 'I' else value)
+            else:
+                columns[name].append(missing[kind])
+        columns[EXTRA].append(intern(json_io.dumps(extra).decode('utf-8')) if extra else MISSING_STRING)
+
+    arena = bytearray()
+    offsets = array('Q', [0])
+    for value in strings:
+        arena += value.encode('utf-8')
+        offsets.append(len(arena))
+
+    sections = [(name, columns[name]) for name, _ in COLUMNS]
+    sections += [(EXTRA, columns[EXTRA]), ('_string_offsets', offsets), ('_string_arena', array('B', arena))]
+
+    if sys.byteorder != 'little':
+        for _, values in sections:
+            values.byteswap()
+
+    out = bytearray(HEADER.size + SECTION.size * len(sections))
+    HEADER.pack_into(out, 0, MAGIC, FORMAT_VERSION, len(sections), len(products), len(strings))
+    for index, (name, values) in enumerate(sections):
+        out += bytes(-len(out) % ALIGNMENT)  # Every section starts 8-byte aligned
+        SECTION.pack_into(out, HEADER.size + index * SECTION.size, name.encode('utf-8'),
+                          values.typecode.encode('ascii'), len(out), len(values) * values.itemsize)
+        out += values.tobytes()
+    return bytes(out)
+
+
+def write_catalog(products, path):
+    """Write a catalog file atomically (readers never see a half-written file)"""
+    data = build_catalog_bytes(products)
+    temporary = f'{path}.tmp'
+    with open(temporary, 'wb') as handle:
+        handle.write(data)
+    os.replace(temporary, path)
+    return len(data)
+
+
+class ProductCatalog:
+    """
+    Read-only product table over a catalog buffer (an mmap or bytes)
+    Columns are zero-copy memoryviews; a product dict is only materialized by catalog[row].
+    Behaves as a sequence of product dicts, so it can stand in for a list of products
+    """
+    def __init__(self, buffer, source=None):
+        self._buffer = buffer
+        self.source = source
+        view = memoryview(buffer)
+
+        if len(view) < HEADER.size:
+            raise ValueError(f"Truncated catalog header: {source}")
+        magic, self.version, section_count, self.rows, string_count = HEADER.unpack_from(view, 0)
+        if magic != MAGIC:
+            raise ValueError(f"Not a product catalog: {source}")
+        if self.version != FORMAT_VERSION:
+            raise ValueError(f"Unsupported catalog version {self.version} (expected {FORMAT_VERSION})")
+        if HEADER.size + section_count * SECTION.size > len(view):
+            raise ValueError(f"Truncated catalog section directory: {source}")
+
+        self.sections = {}
+        for index in range(section_count):
+            raw_name, kind, offset, size = SECTION.unpack_from(view, HEADER.size + index * SECTION.size)
+            try:
+                name, kind = raw_name.rstrip(b'\0').decode('utf-8'), kind.decode('ascii')
+            except UnicodeDecodeError:
+                raise ValueError(f"Corrupt catalog section {index}: {source}") from None
+            expected = self._expected_items(name, string_count)
+            if kind not in _ITEM_SIZES or name in self.sections:
+                raise ValueError(f"Corrupt catalog section {name!r}: {source}")
+            if offset + size > len(view) or size % _ITEM_SIZES[kind] or offset % _ITEM_SIZES[kind]:
+                raise ValueError(f"Catalog section {name!r} is out of bounds or misaligned: {source}")
+            if expected is not None and (kind, size // _ITEM_SIZES[kind]) != expected:
+                raise ValueError(f"Catalog section {name!r} has {size // _ITEM_SIZES[kind]} '{kind}' items, "
+                                 f"expected {expected[1]} '{expected[0]}': {source}")
+            data = view[offset:offset + size]
+            if sys.byteorder != 'little' and kind != 'B':
+                values = array(kind, data.tobytes())  # Copy, big-endian hosts only
+                values.byteswap()
+                data = memoryview(values)
+            self.sections[name] = data.cast(kind) if kind != 'B' else data
+
+        missing = [name for name in _REQUIRED_SECTIONS if name not in self.sections]
+        if missing:
+            raise ValueError(f"Catalog is missing sections {', '.join(missing)}: {source}")
+
+        self._offsets = self.sections['_string_offsets']
+        self._arena = self.sections['_string_arena']
+        if (self._offsets[0] != 0 or self._offsets[-1] != len(self._arena)
+                or any(start > end for start, end in zip(self._offsets, self._offsets[1:]))):
+            raise ValueError(f"Catalog string offsets do not match the arena: {source}")
+        try:
+            str(self._arena, 'utf-8')
+        except UnicodeDecodeError:
+            raise ValueError(f"Catalog string arena is not UTF-8: {source}") from None
+        for name in [name for name, kind in COLUMNS if kind == 'I'] + [EXTRA]:
+            if max((value for value in self.sections[name] if value != MISSING_STRING), default=-1) >= string_count:
+                raise ValueError(f"Catalog column {name!r} references a missing string: {source}")
+
+        self._string_cache = {}
+        self.string_count = string_count
+
+    def _expected_items(self, name, string_count):
+        """(typecode, item count) a known section must have, None for an unknown one"""
+        if name in _KINDS:
+            return _KINDS[name], self.rows
+        if name == EXTRA:
+            return 'I', self.rows
+        if name == '_string_offsets':
+            return 'Q', string_count + 1
+        return None  # The arena's length is checked against the offsets
+
+    @classmethod
+    def open(cls, path):
+        """Map a catalog file read-only"""
+        with open(path, 'rb') as handle:
+            buffer = mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ)
+        return cls(buffer, source=path)
+
+    @classmethod
+    def from_products(cls, products, source='memory'):
+        """In-memory catalog from product dicts (used when no snapshot file exists)"""
+        return cls(build_catalog_bytes(products), source=source)
+
+    def string(self, string_id):
+        """Decoded arena string (cached, so repeated labels are decoded once)"""
+        value = self._string_cache.get(string_id)
+        if value is None:
+            if string_id >= self.string_count:
+                raise ValueError(f"Catalog string id {string_id} out of range: {self.source}")
+            value = str(self._arena[self._offsets[string_id]:self._offsets[string_id + 1]], 'utf-8')
+            self._string_cache[string_id] = value
+        return value
+
+    def column(self, name):
+        """Raw column (memoryview of ints, floats or string ids, with missing-value sentinels)"""
+        return self.sections[name]
+
+    def _extra(self, row):
+        string_id = self.sections[EXTRA][row]
+        if string_id == MISSING_STRING:
+            return {}
+        return json_io.loads(bytes(self._arena[self._offsets[string_id]:self._offsets[string_id + 1]]))
+
+    def _column_value(self, name, kind, row):
+        """(present, value) of a column cell"""
+        value = self.sections[name][row]
+        if kind == 'I':
+            return (True, self.string(value)) if value != MISSING_STRING else (False, None)
+        if kind == 'q':
+            return (value != MISSING_INT), value
+        return (not math.isnan(value)), value
+
+    def field(self, row, name, default=None):
+        """One field of a product without materializing it (like product.get(name, default))"""
+        kind = _KINDS.get(name)
+        if kind is not None:
+            present, value = self._column_value(name, kind, row)
+            if present:
+                return value
+        return self._extra(row).get(name, default)
+
+    def __getitem__(self, row):
+        if not -self.rows <= row < self.rows:
+            raise IndexError('catalog row out of range')
+        row %= self.rows
+        product = {}
+        for name, kind in COLUMNS:
+            present, value = self._column_value(name, kind, row)
+            if present:
+                product[name] = value
+        product.update(self._extra(row))
+        return product
+
+    def __len__(self):
+        return self.rows
+
+    def __iter__(self):
+        for row in range(self.rows):
+            yield self[row]
+
+    def labels(self, name):
+        """Per-row values of a string column (None when missing)"""
+        return [None if string_id == MISSING_STRING else self.string(string_id)
+                for string_id in self.sections[name]]
+
+    def memory_bytes(self):
+        """Size of the mapped catalog"""
+        return len(self._buffer)
+
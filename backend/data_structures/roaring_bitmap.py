@@ -0,0 +1,199 @@
+"""
+Roaring Bitmap - Compressed Sets of Row Numbers
+Rows are split by their high 16 bits into chunks; each chunk is a sorted array when sparse
+and a 65536-bit bitset when dense, so AND/OR cost depends on the data, not the row range
+"""
+
+from array import array
+from bisect import bisect_left
+
+CHUNK_BITS = 16
+CHUNK_SIZE = 1 << CHUNK_BITS
+# Above this many values a chunk is stored as a bitset (8 KB). C roaring switches at 4096, where
+# the sizes break even; here bitset AND/OR/count run as single big-int operations while array
+# containers are walked in Python, so chunks become bitsets at 1/64 density instead
+ARRAY_MAX = 1024
+CHUNK_BYTES = CHUNK_SIZE // 8
+
+
+def _bits_to_array(bits):
+    """Bitset container (int) -> sorted array container"""
+    values = array('H')
+    data = bits.to_bytes(CHUNK_BYTES, 'little')
+    for index, byte in enumerate(data):
+        while byte:
+            low = byte & -byte
+            values.append(index * 8 + low.bit_length() - 1)
+            byte ^= low
+    return values
+
+
+def _array_to_bits(values):
+    """Sorted array container -> bitset container (int)"""
+    data = bytearray(CHUNK_BYTES)
+    for value in values:
+        data[value >> 3] |= 1 << (value & 7)
+    return int.from_bytes(data, 'little')
+
+
+def _normalize(container):
+    """Pick the cheaper representation; None for an empty container"""
+    if isinstance(container, int):
+        count = container.bit_count()
+        if count == 0:
+            return None
+        return _bits_to_array(container) if count <= ARRAY_MAX else container
+    if not container:
+        return None
+    return _array_to_bits(container) if len(container) > ARRAY_MAX else container
+
+
+def _cardinality(container):
+    return container.bit_count() if isinstance(container, int) else len(container)
+
+
+def _and(a, b):
+    if isinstance(a, int) and isinstance(b, int):
+        return _normalize(a & b)
+    if isinstance(a, int):
+        a, b = b, a
+    if isinstance(b, int):
+        data = b.to_bytes(CHUNK_BYTES, 'little')  # Byte lookups instead of big-int shifts
+        return _normalize(array('H', [value for value in a if data[value >> 3] >> (value & 7) & 1]))
+    small, large = (a, b) if len(a) <= len(b) else (b, a)
+    members = set(large)
+    return _normalize(array('H', [value for value in small if value in members]))
+
+
+def _or(a, b):
+    if isinstance(a, int) or isinstance(b, int):
+        a = a if isinstance(a, int) else _array_to_bits(a)
+        b = b if isinstance(b, int) else _array_to_bits(b)
+        return _normalize(a | b)
+    return _normalize(array('H', sorted(set(a).union(b))))
+
+
+class RoaringBitmap:
+    """
+    Immutable set of non-negative integers
+    keys[i] is the high 16 bits shared by the values of containers[i]
+    """
+    def __init__(self, keys=None, containers=None):
+        self.keys = keys or []
+        self.containers = containers or []
+
+    @classmethod
+    def from_sorted(cls, values):
+        """Bitmap of ascending values"""
+        keys, containers = [], []
+        current_key, chunk = None, array('H')
+        for value in values:
+            key = value >> CHUNK_BITS
+            if key != current_key:
+                if chunk:
+                    keys.append(current_key)
+                    containers.append(_normalize(chunk))
+                current_key, chunk = key, array('H')
+            chunk.append(value & (CHUNK_SIZE - 1))
+        if chunk:
+            keys.append(current_key)
+            containers.append(_normalize(chunk))
+        return cls(keys, containers)
+
+    def __and__(self, other):
+        keys, containers = [], []
+        i = j = 0
+        while i < len(self.keys) and j < len(other.keys):
+            if self.keys[i] < other.keys[j]:
+                i += 1
+            elif self.keys[i] > other.keys[j]:
+                j += 1
+            else:
+                container = _and(self.containers[i], other.containers[j])
+                if container is not None:
+                    keys.append(self.keys[i])
+                    containers.append(container)
+                i += 1
+                j += 1
+        return RoaringBitmap(keys, containers)
+
+    def __or__(self, other):
+        keys, containers = [], []
+        i = j = 0
+        while i < len(self.keys) or j < len(other.keys):
+            if j == len(other.keys) or (i < len(self.keys) and self.keys[i] < other.keys[j]):
+                keys.append(self.keys[i])
+                containers.append(self.containers[i])
+                i += 1
+            elif i == len(self.keys) or self.keys[i] > other.keys[j]:
+                keys.append(other.keys[j])
+                containers.append(other.containers[j])
+                j += 1
+            else:
+                keys.append(self.keys[i])
+                containers.append(_or(self.containers[i], other.containers[j]))
+                i += 1
+                j += 1
+        return RoaringBitmap(keys, containers)
+
+    @staticmethod
+    def union_all(bitmaps):
+        result = RoaringBitmap()
+        for bitmap in bitmaps:
+            result = result | bitmap
+        return result
+
+    @staticmethod
+    def intersect_all(bitmaps):
+        """AND of the bitmaps, smallest first (None when there are none)"""
+        result = None
+        for bitmap in sorted(bitmaps, key=len):
+            result = bitmap if result is None else result & bitmap
+        return result
+
+    def __len__(self):
+        return sum(_cardinality(container) for container in self.containers)
+
+    def __bool__(self):
+        return bool(self.keys)
+
+    def __contains__(self, value):
+        index = bisect_left(self.keys, value >> CHUNK_BITS)
+        if index == len(self.keys) or self.keys[index] != value >> CHUNK_BITS:
+            return False
+        container, low = self.containers[index], value & (CHUNK_SIZE - 1)
+        if isinstance(container, int):
+            return bool(container >> low & 1)
+        position = bisect_left(container, low)
+        return position < len(container) and container[position] == low
+
+    def _iter_container(self, key, container):
+        base = key << CHUNK_BITS
+        values = _bits_to_array(container) if isinstance(container, int) else container
+        for low in values:
+            yield base + low
+
+    def __iter__(self):
+        for key, container in zip(self.keys, self.containers):
+            yield from self._iter_container(key, container)
+
+    def page(self, offset=0, limit=None):
+        """Values [offset, offset + limit) in ascending order; whole chunks before offset are skipped"""
+        result = []
+        for key, container in zip(self.keys, self.containers):
+            if limit is not None and len(result) >= limit:
+                break
+            count = _cardinality(container)
+            if offset >= count:
+                offset -= count
+                continue
+            values = _bits_to_array(container) if isinstance(container, int) else container
+            end = len(values) if limit is None else offset + limit - len(result)
+            result.extend((key << CHUNK_BITS) + low for low in values[offset:end])
+            offset = 0
+        return result
+
+    def memory_bytes(self):
+        """Size of the containers"""
+        return sum(CHUNK_BYTES if isinstance(container, int) else 2 * len(container)
+                   for container in self.containers)
@@ -0,0 +1,151 @@
+"""
+Inverted Index Data Structure - Posting List Implementation
+Finds songs sharing a genre, artist or album without scanning the whole catalog
+"""
+
+import heapq
+from array import array
+
+# Similarity weights (same as MusicAnalyzer.find_similar_songs)
+GENRE_WEIGHT = 3
+ARTIST_WEIGHT = 2
+ALBUM_WEIGHT = 1
+
+class SongIndex:
+    """
+    Posting lists: interned field id -> rows of the songs having that value
+    Rows are positions in self.songs; field ids are stored per row in compact arrays
+    """
+    # Largest tie group that gets ranked by feature distance, bigger ones keep index order
+    TIE_BREAK_LIMIT = 256
+    NO_VALUE = 0
+
+    def __init__(self, feature_store=None):
+        self.feature_store = feature_store
+        self.songs = []
+        self.row_of = {}  # song id -> row
+
+        self.genre_ids, self.artist_ids, self.album_ids = {}, {}, {}
+        self.genre_postings, self.artist_postings, self.album_postings = {}, {}, {}
+
+        # Per-row field ids (0 = missing)
+        self.row_genre = array('I')
+        self.row_artist = array('I')
+        self.row_album = array('I')
+
+    def _intern(self, ids, value):
+        """Map a field value to a small integer id (0 means no value)"""
+        if not value:
+            return self.NO_VALUE
+        field_id = ids.get(value)
+        if field_id is None:
+            field_id = len(ids) + 1
+            ids[value] = field_id
+        return field_id
+
+    def _lookup(self, ids, value):
+        """Field id of a value without interning it"""
+        return ids.get(value, self.NO_VALUE) if value else self.NO_VALUE
+
+    def add_song(self, song):
+        """Index one song"""
+        row = len(self.songs)
+        self.songs.append(song)
+        if song.get('id') is not None:
+            self.row_of[song['id']] = row
+
+        for ids, postings, column, field in (
+            (self.genre_ids, self.genre_postings, self.row_genre, 'genre'),
+            (self.artist_ids, self.artist_postings, self.row_artist, 'artist'),
+            (self.album_ids, self.album_postings, self.row_album, 'album'),
+        ):
+            field_id = self._intern(ids, song.get(field))
+            column.append(field_id)
+            if field_id != self.NO_VALUE:
+                postings.setdefault(field_id, array('I')).append(row)
+
+    def build(self, songs):
+        """Index a list of songs"""
+        for song in songs:
+            self.add_song(song)
+        return self
+
+    def size(self):
+        """Number of indexed songs"""
+        return len(self.songs)
+
+    def similar(self, target_song, top_k=5):
+        """
+        Top k songs sharing genre (3), artist (2) or album (1) with the target
+        Returns list of (score, song), highest score first
+        """
+        genre = self._lookup(self.genre_ids, target_song.get('genre'))
+        artist = self._lookup(self.artist_ids, target_song.get('artist'))
+        album = self._lookup(self.album_ids, target_song.get('album'))
+
+        # Artist and album postings are short: score their union exactly
+        scores = {}
+        for field_id, postings, weight in (
+            (artist, self.artist_postings, ARTIST_WEIGHT),
+            (album, self.album_postings, ALBUM_WEIGHT),
+        ):
+            if field_id == self.NO_VALUE:
+                continue
+            for row in postings.get(field_id, ()):
+                scores[row] = scores.get(row, 0) + weight
+
+        if genre != self.NO_VALUE:
+            for row in scores:
+                if self.row_genre[row] == genre:
+                    scores[row] += GENRE_WEIGHT
+
+        # Group candidates by score (only a handful of distinct values)
+        levels = {}
+        for row, score in scores.items():
+            levels.setdefault(score, []).append(row)
+
+        if genre != self.NO_VALUE:
+            # Genre-only songs all score GENRE_WEIGHT, they are pulled lazily below
+            levels.setdefault(GENRE_WEIGHT, [])
+
+        results = []
+        for score in sorted(levels, reverse=True):
+            need = top_k - len(results)
+            if need <= 0:
+                break
+
+            rows = levels[score]
+            if score == GENRE_WEIGHT and genre != self.NO_VALUE:
+                limit = max(need + 1, self.TIE_BREAK_LIMIT - len(rows))
+                rows = rows + self._genre_only_rows(genre, scores, limit)
+
+            results.extend(self._rank_level(score, rows, target_song, need))
+
+        return results
+
+    def _genre_only_rows(self, genre, scored, limit):
+        """First rows of the genre posting that were not already scored"""
+        rows = []
+        for row in self.genre_postings.get(genre, ()):
+            if row not in scored:
+                rows.append(row)
+                if len(rows) >= limit:
+                    break
+        return rows
+
+    def _rank_level(self, score, rows, target_song, count):
+        """Pick count songs from one tie group, closest feature vectors first"""
+        target_id = target_song.get('id')
+        songs = [
+            self.songs[row] for row in rows
+            if self.songs[row] is not target_song
+            and (target_id is None or self.songs[row].get('id') != target_id)
+        ]
+
+        if self.feature_store is None or len(songs) > self.TIE_BREAK_LIMIT:
+            chosen = songs[:count]
+        else:
+            chosen = heapq.nsmallest(
+                count, songs, key=lambda song: self.feature_store.distance(target_song, song)
+            )
+        return [(score, song) for song in chosen]
@@ -0,0 +1,138 @@
+"""
+Song Table - Interned Columnar Storage
+Built once per request (or catalog) and shared by every pipeline stage instead of raw JSON dicts
+"""
+
+from array import array
+
+class StringPool:
+    """
+    Interns field values to small integer ids
+    Id 0 is reserved for a missing key; every other value (None and '' included) gets its own id
+    """
+    MISSING = 0
+
+    def __init__(self):
+        self.ids = {}
+        self.values = [None]  # id -> value (id 0 reads back as None, like song.get)
+
+    def intern(self, value):
+        """Id of a value, assigning a new one on first sight"""
+        value_id = self.ids.get(value)
+        if value_id is None:
+            value_id = len(self.values)
+            self.ids[value] = value_id
+            self.values.append(value)
+        return value_id
+
+    def value(self, value_id):
+        """Original value (None for a missing key)"""
+        return self.values[value_id]
+
+    def label(self, value_id):
+        """Display value, 'Unknown' for a missing key"""
+        return 'Unknown' if value_id == self.MISSING else self.values[value_id]
+
+    def has_value(self, value_id):
+        """True if the key was present with a non-empty value"""
+        return value_id != self.MISSING and bool(self.values[value_id])
+
+    def __len__(self):
+        return len(self.values) - 1
+
+
+class SongTable:
+    """
+    Columns (one entry per row):
+        ids                      - song id (None when absent)
+        title/genre/artist/album - interned ids into the matching StringPool
+        price/duration           - floats (0.0 when absent)
+        weight                   - 1 for playlist songs, 2 for recommendations
+    Playlist rows come first: rows [0, playlist_size) are the playlist
+    """
+    STRING_FIELDS = ('title', 'genre', 'artist', 'album')
+    NUMERIC_FIELDS = ('price', 'duration')
+
+    def __init__(self):
+        self.ids = []
+        self.pools = {field: StringPool() for field in self.STRING_FIELDS}
+        self.strings = {field: array('I') for field in self.STRING_FIELDS}
+        self.numbers = {field: array('d') for field in self.NUMERIC_FIELDS}
+        self.weight = array('B')
+        self.row_of = {}  # song id -> row
+        self.playlist_size = 0
+
+    @classmethod
+    def from_payload(cls, playlist, recommendations):
+        """Build the table from a /api/recommend payload"""
+        table = cls()
+        table.extend(playlist, 1)
+        table.playlist_size = len(table)
+        table.extend(recommendations, 2)
+        return table
+
+    def extend(self, songs, weight=1):
+        """Append songs as rows"""
+        pools = [(self.pools[f], self.strings[f], f) for f in self.STRING_FIELDS]
+        numbers = [(self.numbers[f], f) for f in self.NUMERIC_FIELDS]
+
+        for song in songs:
+            song_id = song.get('id')
+            if song_id is not None:
+                self.row_of.setdefault(song_id, len(self.ids))
+            self.ids.append(song_id)
+
+            for pool, column, field in pools:
+                column.append(pool.intern(song[field]) if field in song else StringPool.MISSING)
+
+            for column, field in numbers:
+                try:
+                    column.append(float(song.get(field) or 0))
+                except (TypeError, ValueError):
+                    column.append(0.0)
+
+            self.weight.append(weight)
+
+    def __len__(self):
+        return len(self.ids)
+
+    @property
+    def recommendations_size(self):
+        return len(self) - self.playlist_size
+
+    def column(self, field):
+        """Raw id (string fields) or number column"""
+        return self.strings[field] if field in self.strings else self.numbers[field]
+
+    def value(self, field, row):
+        """Original value of a field (like song.get(field))"""
+        if field in self.strings:
+            return self.pools[field].value(self.strings[field][row])
+        return self.numbers[field][row]
+
+    def label(self, field, row):
+        """Display value of a string field (like song.get(field, 'Unknown'))"""
+        return self.pools[field].label(self.strings[field][row])
+
+    def song_key(self, row):
+        """Same key SongFeatureStore uses for a song dict"""
+        song_id = self.ids[row]
+        if song_id is not None:
+            return song_id
+        return tuple(self.value(field, row) for field in ('title', 'artist', 'genre', 'album'))
+
+    def song(self, row):
+        """Rebuild a minimal song dict for one row (only for the few rows a response needs)"""
+        song = {'id': self.ids[row]}
+        for field in self.STRING_FIELDS:
+            if self.strings[field][row] != StringPool.MISSING:
+                song[field] = self.value(field, row)
+        for field in self.NUMERIC_FIELDS:
+            song[field] = self.numbers[field][row]
+        return song
+
+    def memory_bytes(self):
+        """Approximate size of the numeric and id columns"""
+        total = sum(c.itemsize * len(c) for c in self.strings.values())
+        total += sum(c.itemsize * len(c) for c in self.numbers.values())
+        return total + self.weight.itemsize * len(self.weight)
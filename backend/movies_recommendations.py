@@ -1,9 +1,15 @@
 from flask import Flask, request, jsonify
 from collections import defaultdict
+from concurrent.futures import ThreadPoolExecutor
+import json
 import math
 
 app = Flask(__name__)
 
+# Users of a /recommend/batch call are ranked concurrently on this shared pool
+batch_executor = ThreadPoolExecutor(max_workers=4, thread_name_prefix="batch")
+MAX_BATCH_SIZE = 1000
+
 
 def analyze_genres(payload):
     watchlist = payload.get("watchlist", [])
@@ -75,6 +81,43 @@ def recommend():
     return jsonify(ordered)
 
 
+@app.route("/recommend/batch", methods=["POST"])
+def recommend_batch():
+    """
+    Rank genres for many users in one call
+    Body: {"requests": [payload, ...]} where each payload is a /recommend body
+    Returns {"results": [ordered genres, ...]} in request order (null for a malformed payload)
+    """
+    try:
+        payload = request.get_json()
+    except:
+        return "Invalid JSON", 400
+
+    payloads = payload.get("requests") if isinstance(payload, dict) else None
+    if not isinstance(payloads, list) or not payloads or len(payloads) > MAX_BATCH_SIZE:
+        return jsonify({"error": f"requests must be a list of 1 to {MAX_BATCH_SIZE} payloads"}), 400
+
+    # Users with identical watchlists and preferences are ranked once
+    unique = {}
+    for item in payloads:
+        if isinstance(item, dict):
+            unique.setdefault(json.dumps(item, sort_keys=True), item)
+
+    def run(key):
+        try:
+            return analyze_genres(unique[key])
+        except Exception as e:
+            print(f"Error: {e}")
+            return None  # One bad payload does not fail the batch
+
+    keys = list(unique)
+    ranked = dict(zip(keys, batch_executor.map(run, keys)))
+
+    results = [ranked[json.dumps(item, sort_keys=True)] if isinstance(item, dict) else None
+               for item in payloads]
+    return jsonify({"results": results})
+
+
 if __name__ == "__main__":
     print("Server running on port 8080...")
     app.run(host="0.0.0.0", port=8080)
\ No newline at end of file
@@ -1,8 +1,15 @@
+import os
 import json
+import time
 import requests
 from flask import Flask, jsonify, request
 from flask_cors import CORS
 from collections import defaultdict
+from concurrent.futures import ThreadPoolExecutor
+
+from data_structures.product_catalog import ProductCatalog
+from data_structures.id_index import IdIndex
+from data_structures.facet_index import FacetIndex
 
 app = Flask(__name__)
 CORS(app)
@@ -11,10 +18,24 @@ CORS(app)
 UPSTREAM_API = "https://dummyjson.com/products?limit=0" 
 # Note: limit=0 gets ALL products in DummyJSON so we have a better pool to search from
 
+# Offline catalog snapshot, mmap'ed at startup so the server does not need the network
+# Build it with: python -m tools.build_catalog products.json data/products.catalog
+CATALOG_PATH = os.environ.get('LINKLAB_CATALOG',
+                              os.path.join(os.path.dirname(os.path.abspath(__file__)), 'data', 'products.catalog'))
+
 # --- DATA & MAPPINGS ---
-PRODUCTS_DB = []
+PRODUCTS_DB = ProductCatalog.from_products([])  # Sequence of product dicts, materialized per row
 CATEGORIES_DB = []
 
+# Built once per catalog load and shared by every request (see build_indexes)
+TOP_RATED = []       # Rows of the cold start recommendations
+ID_INDEX = IdIndex([])  # product id -> row of PRODUCTS_DB
+FACET_INDEX = FacetIndex(PRODUCTS_DB)  # Roaring bitmaps of rows per category, brand, price, rating, stock
+
+# Carts of a /api/recommend/batch call are scored concurrently on this shared pool
+batch_executor = ThreadPoolExecutor(max_workers=4, thread_name_prefix='batch')
+MAX_BATCH_SIZE = 1000
+
 # Define related categories so the AI knows "Makeup" relates to "Skincare" but not "Furniture"
 CATEGORY_GROUPS = {
     'tech': ['smartphones', 'laptops', 'tablets', 'mobile-accessories'],
@@ -26,16 +47,40 @@ CATEGORY_GROUPS = {
 
 def load_data():
     global PRODUCTS_DB, CATEGORIES_DB
-    try:
-        print("⏳ Loading product catalog...")
-        # Fetch all products (limit=0 usually fetches all in dummyjson, or we set a high number)
-        response = requests.get("https://dummyjson.com/products?limit=194") 
-        data = response.json()
-        PRODUCTS_DB = data.get('products', [])
-        CATEGORIES_DB = list(set(p['category'] for p in PRODUCTS_DB))
-        print(f"✅ Loaded {len(PRODUCTS_DB)} products.")
-    except Exception as e:
-        print(f"❌ Error loading data: {e}")
+    print("⏳ Loading product catalog...")
+    start = time.perf_counter()
+    catalog = None
+
+    if os.path.exists(CATALOG_PATH):
+        try:
+            catalog = ProductCatalog.open(CATALOG_PATH)
+        except Exception as e:
+            print(f"❌ Error opening catalog snapshot {CATALOG_PATH}: {e}")
+
+    if catalog is None:
+        # No usable snapshot: fall back to the upstream API
+        try:
+            # Fetch all products (limit=0 usually fetches all in dummyjson, or we set a high number)
+            response = requests.get("https://dummyjson.com/products?limit=194") 
+            data = response.json()
+            catalog = ProductCatalog.from_products(data.get('products', []), source='network')
+            print(f"⚠️  No catalog snapshot at {CATALOG_PATH}, loaded from the network")
+        except Exception as e:
+            print(f"❌ Error loading data: {e}")
+            return
+
+    PRODUCTS_DB = catalog
+    CATEGORIES_DB = list(set(category for category in PRODUCTS_DB.labels('category') if category is not None))
+    build_indexes()
+    print(f"✅ Loaded {len(PRODUCTS_DB)} products from {PRODUCTS_DB.source} "
+          f"in {(time.perf_counter() - start) * 1000:.1f} ms.")
+
+def build_indexes():
+    """Facet bitmaps, the cold start list and the id index, so requests never scan the catalog"""
+    global TOP_RATED, ID_INDEX, FACET_INDEX
+    TOP_RATED = sorted(range(len(PRODUCTS_DB)), key=lambda row: PRODUCTS_DB.field(row, 'rating', 0), reverse=True)[:12]
+    ID_INDEX = IdIndex(PRODUCTS_DB.column('id'))
+    FACET_INDEX = FacetIndex(PRODUCTS_DB)
 
 def get_related_categories(target_category):
     """Finds siblings in the same group (e.g., 'makeup' -> ['skincare', 'fragrances'])"""
@@ -48,7 +93,7 @@ def get_related_categories(target_category):
 def get_recommendations(cart_items, strategy='hybrid'):
     # 1. COLD START: If cart is empty, show top rated diverse items
     if not cart_items:
-        return sorted(PRODUCTS_DB, key=lambda x: x.get('rating', 0), reverse=True)[:12]
+        return [PRODUCTS_DB[row] for row in TOP_RATED]
 
     # 2. ANALYZE CART
     cart_ids = {item.get('id') for item in cart_items}
@@ -59,70 +104,89 @@ def get_recommendations(cart_items, strategy='hybrid'):
     for c in cart_categories:
         category_counts[c] += 1
 
+    # Only products in a cart category or a related one can score above 0,
+    # so just those are visited (in catalog order, which keeps ties stable)
+    related_categories = set()
+    for cart_cat in category_counts:
+        related_categories.update(get_related_categories(cart_cat))
+    candidates = FACET_INDEX.values_bitmap('category', set(category_counts) | related_categories)
+
     scored_products = []
+    cart_avg_price = None
 
     # 3. SCORE PRODUCTS
-    for product in PRODUCTS_DB:
+    # Fields are read straight from the catalog columns; only the returned products are materialized
+    for position in candidates:
         # Skip items already in cart
-        if product['id'] in cart_ids:
+        if PRODUCTS_DB.field(position, 'id') in cart_ids:
             continue
 
-        score = 0
-        p_cat = product['category']
+        p_cat = PRODUCTS_DB.field(position, 'category')
         
         # --- SCORING RULES ---
         
         # Rule A: EXACT Category Match (The most important factor)
         # We give this a HUGE score (100) so it beats everything else
         if p_cat in category_counts:
-            score += 100 * category_counts[p_cat]
+            score = 100 * category_counts[p_cat]
         
         # Rule B: RELATED Category Match (Cluster logic)
         # If user bought 'makeup', suggest 'skincare' (Score: 20)
         else:
-            for cart_cat in category_counts:
-                related = get_related_categories(cart_cat)
-                if p_cat in related:
-                    score += 20
-                    break
+            score = 20
         
         # Rule C: Rating Boost (Collaborative Simulation)
-        # ONLY apply rating boost if the item is at least somewhat relevant (score > 0)
-        # This prevents 5-star Furniture from showing up for Makeup users
-        if score > 0:
-            score += product.get('rating', 0)
-            
-            # Tiny price similarity boost
+        # Candidates are always relevant (score > 0), so 5-star Furniture never shows up for Makeup users
+        score += PRODUCTS_DB.field(position, 'rating', 0)
+        
+        # Tiny price similarity boost
+        if cart_avg_price is None:
             cart_avg_price = sum(i['price'] for i in cart_items) / len(cart_items)
-            if abs(product['price'] - cart_avg_price) < 50:
-                score += 5
+        if abs(PRODUCTS_DB.field(position, 'price') - cart_avg_price) < 50:
+            score += 5
 
-        # If score is still 0, it means it's completely unrelated (e.g., Furniture vs Makeup)
-        # We filter it out by not adding it to the list, or giving it a negative score.
-        if score > 0:
-            scored_products.append((product, score))
+        scored_products.append((position, score))
 
     # 4. SORT & RETURN
     scored_products.sort(key=lambda x: x[1], reverse=True)
     
     # Return top results
-    return [p[0] for p in scored_products[:15]]
+    return [PRODUCTS_DB[p[0]] for p in scored_products[:15]]
 
 
 # --- API ENDPOINTS ---
 @app.route('/api/products', methods=['GET'])
 def get_products():
-    category = request.args.get('category')
+    """
+    Products matching the filters, optionally one page at a time
+    Facets: category, brand, price, rating (comma-separated values are ORed), in_stock=true|false,
+    min_rating=<whole stars>; facets are ANDed together and with search (title substring).
+    offset/limit select the page, facets=1 adds per-value counts
+    """
+    selected = {}
+    for facet in FacetIndex.FACETS:
+        value = request.args.get(facet)
+        if value and value != 'all':
+            selected[facet] = [v.strip() for v in value.split(',') if v.strip()]
+
+    min_rating = request.args.get('min_rating', type=int)
+    if min_rating is not None:
+        stars = FACET_INDEX.ratings_at_least(min_rating)
+        selected['rating'] = [v for v in selected.get('rating', stars) if v in stars]
+
     search = request.args.get('search')
-    results = PRODUCTS_DB
-    
-    if category and category != 'all':
-        results = [p for p in results if p['category'] == category]
-    if search:
-        term = search.lower()
-        results = [p for p in results if term in p['title'].lower()]
-        
-    return jsonify({"products": results})
+    extra = [FACET_INDEX.search(search)] if search else []
+
+    # Bitmap AND/OR, then only the requested page is materialized
+    matches = FACET_INDEX.filter(selected, extra)
+    offset = max(0, request.args.get('offset', 0, type=int))
+    limit = request.args.get('limit', type=int)
+    rows = matches.page(offset, max(0, limit) if limit is not None else None)
+
+    response = {"products": [PRODUCTS_DB[row] for row in rows], "total": len(matches)}
+    if request.args.get('facets') in ('1', 'true'):
+        response["facets"] = FACET_INDEX.counts(selected, extra)
+    return jsonify(response)
 
 @app.route('/api/categories', methods=['GET'])
 def get_categories():
@@ -130,8 +194,8 @@ def get_categories():
 
 @app.route('/api/product/<int:product_id>', methods=['GET'])
 def get_product_detail(product_id):
-    product = next((p for p in PRODUCTS_DB if p['id'] == product_id), None)
-    if product: return jsonify(product)
+    row = ID_INDEX.get(product_id)
+    if row is not None: return jsonify(PRODUCTS_DB[row])
     return jsonify({"error": "Not found"}), 404
 
 @app.route('/api/recommend', methods=['POST'])
@@ -148,6 +212,33 @@ def recommend():
         print(f"Error: {e}")
         return jsonify([]), 500
 
+@app.route('/api/recommend/batch', methods=['POST'])
+def recommend_batch():
+    """
+    Recommendations for many carts in one call
+    Body: {"requests": [{"cart": [...], "strategy": "hybrid"}, ...]}
+    Returns {"results": [products, ...]} in request order (null for a cart that fails);
+    carts share the catalog indexes and are scored concurrently
+    A body that is not valid JSON or has no requests list gets a 400 {"error": ...}
+    """
+    try:
+        payload = request.get_json(silent=True)
+        requests_list = payload.get('requests') if isinstance(payload, dict) else None
+        if not isinstance(requests_list, list) or not requests_list or len(requests_list) > MAX_BATCH_SIZE:
+            return jsonify({"error": f"requests must be a list of 1 to {MAX_BATCH_SIZE} carts"}), 400
+
+        def run(item):
+            try:
+                return get_recommendations(item.get('cart', []), item.get('strategy', 'hybrid'))
+            except Exception as e:
+                print(f"Error: {e}")
+                return None  # One bad cart does not fail the batch
+
+        return jsonify({"results": list(batch_executor.map(run, requests_list))})
+    except Exception as e:
+        print(f"Error: {e}")
+        return jsonify({"results": []}), 500
+
 if __name__ == '__main__':
     load_data()
     app.run(host='0.0.0.0', port=8000, debug=True)
\ No newline at end of file
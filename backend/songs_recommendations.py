@@ -1,6 +1,8 @@
 from flask import Flask, request, jsonify
 from flask_cors import CORS
 import json
+import logging
+from contextlib import nullcontext
 from datetime import datetime
 
 # Import all data structures
@@ -8,6 +10,8 @@ from data_structures.graph import MusicGraph
 from data_structures.heap import RecommendationHeap
 from data_structures.trie import GenreTrie
 from data_structures.bst import ArtistBST
+from data_structures.playlist_lsh import PlaylistLSHIndex
+from data_structures.song_table import SongTable
 
 # Import all algorithms
 from algorithms.dijkstra import DijkstraAlgorithm
@@ -16,86 +20,261 @@ from algorithms.sorting import QuickSort, MergeSort
 
 # Import utilities
 from utils.analyzer import MusicAnalyzer
+from utils.response_cache import ResponseCache, fingerprint
+from utils import json_io
+from utils.metrics import MetricsRegistry
+from utils.pipeline import StagePipeline, create_stage_executor
+from utils.playlist_events import apply_events, PlaylistEventError
+from utils.graph_export import GraphExport
+from utils.sessions import SessionManager
 
 app = Flask(__name__)
 CORS(app)
 
-# Initialize data structures (global instances)
-music_graph = MusicGraph()
-recommendation_heap = RecommendationHeap()
-genre_trie = GenreTrie()
-artist_bst = ArtistBST()
+# Request-path diagnostics go through logging (off by default) instead of print
+logger = logging.getLogger(__name__)
+
+# Per-session engines (graph, heap, trie, BST) and request data
+sessions = SessionManager(max_resident=64)
+
+# Shared, stateless or internally synchronized services
 music_analyzer = MusicAnalyzer()
+playlist_index = PlaylistLSHIndex()  # MinHash signatures of every user's playlist
+response_cache = ResponseCache(capacity=256, ttl=300)  # payload fingerprint -> (response body, session state)
+
+# Independent pipeline stages (trie, BST, clustering, ...) run concurrently here
+stage_executor = create_stage_executor(max_workers=4)
+
+# Users of a /api/recommend/batch call are scored concurrently here (a separate pool, so
+# batch items never wait behind the stages of single requests)
+batch_executor = create_stage_executor(max_workers=4, name='batch')
+MAX_BATCH_SIZE = 1000
+
+# Per-stage latency histograms, exported at /metrics
+metrics = MetricsRegistry()
+metrics.gauge('response_cache_hits', "Response cache hits since start", lambda: response_cache.hits)
+metrics.gauge('response_cache_misses', "Response cache misses since start", lambda: response_cache.misses)
+metrics.gauge('sessions_resident', "Sessions with live engines", lambda: sessions.get_statistics()['resident'])
 
-# Global storage
-app_data = {
-    'playlist': [],
-    'recommendations': [],
-    'users': [],
-    'last_updated': None
+# Response field -> pipeline steps it needs (graph, Dijkstra and scoring always run)
+FIELD_STAGES = {
+    'orderedGenres': ('quicksort',),
+    'genreCounts': (),
+    'artistCounts': (),
+    'recommendationScores': (),
+    'topRecommendations': ('heap',),
+    'distances': (),
+    'clusters': ('clustering',),
+    'graphStructure': ('edges',),
+    'trieStats': ('trie',),
+    'bstStats': ('bst',),
+    'algorithmMetrics': ('heap', 'clustering', 'quicksort', 'mergesort'),
+    'insights': ('insights',)
 }
 
+def parse_fields(value):
+    """
+    Requested response fields from a list or comma-separated string (None means all)
+    Raises ValueError on unknown field names
+    """
+    if value is None:
+        return list(FIELD_STAGES)
+    if isinstance(value, str):
+        value = [field.strip() for field in value.split(',') if field.strip()]
+    
+    unknown = [field for field in value if field not in FIELD_STAGES]
+    if unknown or not value:
+        raise ValueError(f"fields must be a non-empty subset of: {', '.join(FIELD_STAGES)}")
+    return [field for field in FIELD_STAGES if field in value]
+
+def get_session_id(data=None):
+    """Session of a request: X-Session-Id header, then session_id/user_id body field, then ?session_id="""
+    session_id = request.headers.get('X-Session-Id')
+    if not session_id and isinstance(data, dict):
+        session_id = data.get('session_id') or data.get('user_id')
+    if not session_id:
+        session_id = request.args.get('session_id')
+    return str(session_id) if session_id else None
+
 @app.route('/api/recommend', methods=['POST'])
 def get_recommendations():
     """Main recommendation endpoint using ALL data structures and algorithms"""
     try:
-        print("\n" + "="*60)
-        print("🎵 Processing Recommendation Request...")
-        print("="*60)
-        
-        data = request.json
-        playlist = data.get('playlist', [])
-        recommendations = data.get('recommendations', [])
-        users = data.get('users', [])
-        
-        # Store data
-        app_data['playlist'] = playlist
-        app_data['recommendations'] = recommendations
-        app_data['users'] = users
-        app_data['last_updated'] = datetime.now().isoformat()
-        
-        print(f"📊 Received: {len(playlist)} playlist songs, {len(recommendations)} recommendations")
-        
-        # ==========================================
-        # STEP 1: BUILD GRAPH STRUCTURE
-        # ==========================================
-        print("\n1️⃣  Building Graph (graph.py)...")
-        music_graph.clear()
-        
-        for song in playlist + recommendations:
-            music_graph.add_song(song)
-        
-        graph_result = music_graph.build_genre_graph(playlist, recommendations)
-        print(f"   ✓ Graph built: {music_graph.node_count()} nodes, {music_graph.edge_count()} edges")
-        print(f"   ✓ Graph density: {music_graph.get_graph_density():.2f}")
-        
-        # ==========================================
-        # STEP 2: APPLY DIJKSTRA'S ALGORITHM
-        # ==========================================
-        print("\n2️⃣  Running Dijkstra's Algorithm (dijkstra.py)...")
-        dijkstra = DijkstraAlgorithm(music_graph)
-        distances = dijkstra.compute_shortest_paths()
-        print(f"   ✓ Dijkstra completed in {dijkstra.execution_time:.4f}s")
-        print(f"   ✓ Computed distances for {len(distances)} genres")
-        
-        # Find most central genre
-        central_genre = dijkstra.find_most_central_genre()
-        if central_genre:
-            print(f"   ✓ Most central genre: {central_genre[0]}")
-        
-        # ==========================================
-        # STEP 3: CALCULATE SCORES & USE MAX HEAP
-        # ==========================================
-        print("\n3️⃣  Using Max Heap for Priority (heap.py)...")
-        recommendation_heap.clear()
-        genre_scores = music_analyzer.calculate_genre_scores(playlist, recommendations, distances)
+        with metrics.span('request'):
+            return _recommend()
+    
+    except Exception as e:
+        logger.exception("Error processing recommendation request")
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 500
+
+def _recommend():
+    """Validate the request, then answer it from the cache or the pipeline"""
+    with metrics.span('parse'):
+        data = json_io.loads(request.get_data())
+    
+    try:
+        playlist, recommendations, users, limit, fields = parse_recommend_request(data, request.args)
+    except ValueError as e:
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 400
+    
+    with sessions.locked(get_session_id(data)) as session:
+        body, cache_status = _recommend_for(session, playlist, recommendations,
+                                            users, limit, fields, stage_executor)
+    return app.response_class(body, mimetype='application/json', headers={'X-Cache': cache_status})
+
+def parse_recommend_request(data, defaults=None):
+    """
+    (playlist, recommendations, users, limit, fields) of a recommendation payload
+    limit and fields fall back to `defaults` (query args, or the batch body); raises ValueError
+    """
+    defaults = defaults or {}
+    playlist = data.get('playlist', [])
+    recommendations = data.get('recommendations', [])
+    users = data.get('users', [])
+    
+    # Optional: only rank the top `limit` genres (body field or ?limit=)
+    limit = data.get('limit', defaults.get('limit'))
+    if limit is not None:
+        try:
+            limit = int(limit)
+        except (TypeError, ValueError):
+            limit = -1
+        if limit <= 0:
+            raise ValueError('limit must be a positive integer')
+    
+    # Optional: only compute the requested response fields (fields/include, body or query)
+    fields = parse_fields(data.get('fields', data.get('include',
+                          defaults.get('fields', defaults.get('include')))))
+    return playlist, recommendations, users, limit, fields
+
+def _recommend_for(session, playlist, recommendations, users, limit, fields, executor):
+    """
+    Answer one payload for a session (None: answer without storing anything)
+    The caller holds the session's lock (see SessionManager.locked)
+    Returns (serialized body, 'HIT' or 'MISS')
+    """
+    if session is not None:
+        session.set_data(playlist, recommendations, users, datetime.now().isoformat())
+    
+    # Identical payloads (every dashboard reload) are served from the cache
+    with metrics.span('cache_lookup'):
+        cache_key = fingerprint(playlist, recommendations, limit, fields)
+        cached = response_cache.get(cache_key)
+    if cached is not None:
+        body, state = cached
+        if session is not None:
+            session.publish(fingerprint=cache_key, **state)
+        return body, 'HIT'
+    
+    return _run_pipeline(session, cache_key, playlist, recommendations, limit, fields, executor), 'MISS'
+
+@app.route('/api/recommend/batch', methods=['POST'])
+def get_batch_recommendations():
+    """
+    Recommendations for many users in one call (e.g. nightly precomputation)
+    Body: {"requests": [{"user_id": ..., "playlist": [...], "recommendations": [...]}, ...],
+           "fields": ..., "limit": ...}   (batch-wide defaults for every request)
+    Requests with a user_id/session_id update that user's session, and payloads already in the
+    response cache are not recomputed. Users are scored in parallel on the batch pool (each
+    pipeline runs serially); results come back in request order, shaped like /api/recommend's
+    """
+    try:
+        with metrics.span('batch'):
+            data = json_io.loads(request.get_data())
+            items = data.get('requests')
+            if not isinstance(items, list) or not items:
+                return jsonify({
+                    'success': False,
+                    'error': 'requests must be a non-empty list'
+                }), 400
+            if len(items) > MAX_BATCH_SIZE:
+                return jsonify({
+                    'success': False,
+                    'error': f'at most {MAX_BATCH_SIZE} requests per batch'
+                }), 400
+            
+            def run(item):
+                try:
+                    if not isinstance(item, dict):
+                        raise ValueError('each request must be an object')
+                    playlist, recommendations, users, limit, fields = parse_recommend_request(item, data)
+                    session_id = item.get('session_id') or item.get('user_id')
+                    with (sessions.locked(str(session_id)) if session_id else nullcontext()) as session:
+                        return _recommend_for(session, playlist, recommendations, users, limit, fields, None)[0]
+                except ValueError as e:
+                    return json_io.dumps({'success': False, 'error': str(e)})
+                except Exception as e:
+                    logger.exception("Error processing batch request")
+                    return json_io.dumps({'success': False, 'error': str(e)})
+            
+            bodies = list(batch_executor.map(run, items))
         
-        for genre, score in genre_scores.items():
+        # Item bodies are already serialized; splice them into the batch response
+        body = b''.join([b'{"count":', str(len(bodies)).encode(), b',"results":[',
+                         b','.join(body.rstrip(b'\n') for body in bodies), b'],"success":true}\n'])
+        return app.response_class(body, mimetype='application/json')
+    
+    except Exception as e:
+        logger.exception("Error processing batch recommendation request")
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 500
+
+def _build_pipeline(playlist, recommendations, limit, stages):
+    """
+    The recommendation steps as a dependency DAG (stage -> stages it reads):
+    
+        table ─┬─ graph ─┬─ dijkstra ─┬─ scoring ─┬─ heap / trie / quicksort
+               │         └─ edges     └─ mergesort
+               ├─ artists ── bst
+               ├─ clustering
+               └─ insights
+    
+    Optional steps are only added when a requested field needs them
+    """
+    pipeline = StagePipeline(span=metrics.span)
+    
+    # Intern the payload once into columns, shared by every step below
+    def build_table(r):
+        song_table = SongTable.from_payload(playlist, recommendations)
+        return song_table, music_analyzer.aggregate(playlist, recommendations, song_table)
+    pipeline.add('table', build_table)
+    
+    # STEP 1: BUILD GRAPH STRUCTURE
+    def build_graph(r):
+        _, aggregate = r['table']
+        music_graph = MusicGraph()  # Fresh engines: cached responses and other sessions keep theirs
+        music_graph.add_genre_counts(aggregate.song_genre_counts)
+        return music_graph, music_graph.build_genre_graph(playlist, recommendations, aggregate)
+    pipeline.add('graph', build_graph, ['table'])
+    
+    # STEP 2: APPLY DIJKSTRA'S ALGORITHM
+    def run_dijkstra(r):
+        dijkstra = DijkstraAlgorithm(r['graph'][0])
+        return dijkstra, dijkstra.compute_shortest_paths()
+    pipeline.add('dijkstra', run_dijkstra, ['graph'])
+    
+    def score_genres(r):
+        _, aggregate = r['table']
+        return music_analyzer.calculate_genre_scores(playlist, recommendations, r['dijkstra'][1], aggregate)
+    pipeline.add('scoring', score_genres, ['table', 'dijkstra'])
+    
+    pipeline.add('artists', lambda r: music_analyzer.analyze_artists(playlist, recommendations, r['table'][1]),
+                 ['table'])
+    
+    # STEP 3: CALCULATE SCORES & USE MAX HEAP
+    def build_heap(r):
+        recommendation_heap = RecommendationHeap()
+        for genre, score in r['scoring'].items():
             recommendation_heap.insert(genre, score)
         
-        print(f"   ✓ Heap built with {recommendation_heap.size()} items")
-        print(f"   ✓ Heap property valid: {recommendation_heap.validate_heap_property()}")
-        
         # Extract top recommendations
         top_recommendations = []
         heap_size = min(10, recommendation_heap.size())
@@ -106,143 +285,192 @@ def get_recommendations():
         for _ in range(heap_size):
             if temp_heap.size() > 0:
                 top_recommendations.append(temp_heap.extract_max())
-        
-        print(f"   ✓ Top recommendation: {top_recommendations[0]['genre'] if top_recommendations else 'None'}")
-        
-        # ==========================================
-        # STEP 4: BUILD TRIE FOR GENRE SEARCH
-        # ==========================================
-        print("\n4️⃣  Building Trie for Search (trie.py)...")
-        genre_trie.clear()
-        
-        for genre in genre_scores.keys():
+        return recommendation_heap, top_recommendations
+    if 'heap' in stages:
+        pipeline.add('heap', build_heap, ['scoring'])
+    
+    # STEP 4: BUILD TRIE FOR GENRE SEARCH
+    def build_trie(r):
+        genre_trie = GenreTrie()
+        for genre in r['scoring'].keys():
             genre_trie.insert(genre)
-        
-        trie_stats = genre_trie.get_statistics()
-        print(f"   ✓ Trie indexed {trie_stats['total_words']} genres")
-        print(f"   ✓ Max depth: {trie_stats['max_depth']}")
-        
-        # ==========================================
-        # STEP 5: BUILD BST FOR ARTIST MANAGEMENT
-        # ==========================================
-        print("\n5️⃣  Building BST for Artists (bst.py)...")
-        artist_bst.clear()
-        artist_data = music_analyzer.analyze_artists(playlist, recommendations)
-        
-        for artist, count in artist_data.items():
+        return genre_trie
+    if 'trie' in stages:
+        pipeline.add('trie', build_trie, ['scoring'])
+    
+    # STEP 5: BUILD BST FOR ARTIST MANAGEMENT
+    def build_bst(r):
+        artist_bst = ArtistBST()
+        for artist, count in r['artists'].items():
             artist_bst.insert(artist, count)
-        
-        bst_stats = artist_bst.get_statistics()
-        print(f"   ✓ BST built with {bst_stats['size']} artists")
-        print(f"   ✓ Tree height: {bst_stats['height']}")
-        print(f"   ✓ Tree balanced: {bst_stats['is_balanced']}")
-        
-        # ==========================================
-        # STEP 6: APPLY CLUSTERING ALGORITHM
-        # ==========================================
-        print("\n6️⃣  Running K-Means Clustering (clustering.py)...")
+        return artist_bst
+    if 'bst' in stages:
+        pipeline.add('bst', build_bst, ['artists'])
+    
+    # STEP 6: APPLY CLUSTERING ALGORITHM
+    def run_clustering(r):
         clusterer = MusicClusterer(k=5)
-        clusters = clusterer.cluster_songs(playlist + recommendations)
-        print(f"   ✓ Created {clusters['total_clusters']} clusters")
-        print(f"   ✓ Clustering completed in {clusterer.execution_time:.4f}s")
-        print(f"   ✓ Silhouette score: {clusters['silhouette_score']}")
-        
-        # ==========================================
-        # STEP 7: SORT USING QUICKSORT & MERGESORT
-        # ==========================================
-        print("\n7️⃣  Sorting with Algorithms (sorting.py)...")
+        return clusterer, clusterer.cluster_songs(playlist + recommendations, table=r['table'][0])
+    if 'clustering' in stages:
+        pipeline.add('clustering', run_clustering, ['table'])
+    
+    # STEP 7: SORT USING QUICKSORT & MERGESORT
+    def run_quicksort(r):
         quick_sorter = QuickSort()
+        if limit is not None:
+            return quick_sorter, quick_sorter.top_k(r['scoring'], limit)
+        return quick_sorter, quick_sorter.sort_by_score(r['scoring'])
+    if 'quicksort' in stages:
+        pipeline.add('quicksort', run_quicksort, ['scoring'])
+    
+    def run_mergesort(r):
         merge_sorter = MergeSort()
-        
-        ordered_genres_quick = quick_sorter.sort_by_score(genre_scores)
-        ordered_genres_merge = merge_sorter.sort_by_distance(distances)
-        
-        print(f"   ✓ QuickSort: {quick_sorter.comparison_count} comparisons in {quick_sorter.execution_time:.6f}s")
-        print(f"   ✓ MergeSort: {merge_sorter.comparison_count} comparisons in {merge_sorter.execution_time:.6f}s")
-        
-        # ==========================================
-        # STEP 8: FLATTEN EDGES FOR FRONTEND
-        # ==========================================
+        return merge_sorter, merge_sorter.sort_by_distance(r['dijkstra'][1])
+    if 'mergesort' in stages:
+        pipeline.add('mergesort', run_mergesort, ['dijkstra'])
+    
+    # STEP 8: FLATTEN EDGES FOR FRONTEND
+    def flatten_edges(r):
+        music_graph, graph_result = r['graph']
         raw_graph = graph_result['edges'] if 'edges' in graph_result else []
-        flat_edges = []
-        seen_pairs = set()
+        if raw_graph:
+            return raw_graph
         
         # If edges not in expected format, build from adjacency list
-        if not raw_graph:
-            adjacency_list = music_graph.get_adjacency_list()
-            for source, targets in adjacency_list.items():
-                for target_data in targets:
-                    target = target_data['to']
-                    pair = tuple(sorted((source, target)))
-                    if pair not in seen_pairs:
-                        flat_edges.append({
-                            'from': source,
-                            'to': target,
-                            'weight': target_data['weight']
-                        })
-                        seen_pairs.add(pair)
-        else:
-            flat_edges = raw_graph
-        
-        # ==========================================
-        # PREPARE FINAL RESPONSE
-        # ==========================================
-        print("\n✅ All data structures processed successfully!")
-        print("="*60 + "\n")
-        
-        response_data = {
-            'success': True,
-            'orderedGenres': ordered_genres_quick,
-            'genreCounts': graph_result['genre_counts'],
-            'artistCounts': dict(list(artist_data.items())[:10]),
-            'recommendationScores': genre_scores,
-            'topRecommendations': top_recommendations,
-            'distances': distances,
-            'clusters': {
-                'total': clusters['total_clusters'],
-                'sizes': clusters['cluster_sizes'],
-                'silhouette_score': clusters['silhouette_score']
-            },
-            'graphStructure': {
-                'nodes': list(graph_result['genre_counts'].keys()),
-                'edges': flat_edges,
-                'adjacency_list': music_graph.get_adjacency_list(),
-                'density': music_graph.get_graph_density()
-            },
-            'trieStats': trie_stats,
-            'bstStats': {
-                'total_artists': bst_stats['size'],
-                'height': bst_stats['height'],
-                'is_balanced': bst_stats['is_balanced'],
-                'inorder': artist_bst.inorder_traversal()[:10],
-                'min_artist': bst_stats['min'],
-                'max_artist': bst_stats['max']
-            },
-            'algorithmMetrics': {
-                'dijkstra_time': dijkstra.execution_time,
-                'clustering_time': clusterer.execution_time,
-                'quicksort_comparisons': quick_sorter.comparison_count,
-                'quicksort_time': quick_sorter.execution_time,
-                'mergesort_comparisons': merge_sorter.comparison_count,
-                'mergesort_time': merge_sorter.execution_time,
-                'graph_nodes': music_graph.node_count(),
-                'graph_edges': music_graph.edge_count(),
-                'heap_size': recommendation_heap.size()
-            },
-            'insights': music_analyzer.generate_insights(playlist, recommendations),
-            'timestamp': datetime.now().isoformat()
+        flat_edges = []
+        seen_pairs = set()
+        for source, targets in music_graph.get_adjacency_list().items():
+            for target_data in targets:
+                target = target_data['to']
+                pair = tuple(sorted((source, target)))
+                if pair not in seen_pairs:
+                    flat_edges.append({
+                        'from': source,
+                        'to': target,
+                        'weight': target_data['weight']
+                    })
+                    seen_pairs.add(pair)
+        return flat_edges
+    if 'edges' in stages:
+        pipeline.add('edges', flatten_edges, ['graph'])
+    
+    if 'insights' in stages:
+        pipeline.add('insights', lambda r: music_analyzer.generate_insights(playlist, recommendations, r['table'][1]),
+                     ['table'])
+    
+    return pipeline
+
+def _run_pipeline(session, cache_key, playlist, recommendations, limit, fields, executor):
+    """
+    Run the pipeline on fresh engines, publish them to the session and cache the response
+    Graph, Dijkstra and scoring always run; the other steps only run when a requested field needs them.
+    Independent steps run concurrently on `executor` (serially when None), each timed as a span
+    of its name (see /metrics)
+    Returns the serialized response body
+    """
+    stages = set()
+    for field in fields:
+        stages.update(FIELD_STAGES[field])
+    
+    logger.debug("Pipeline for %d playlist songs, %d recommendations, fields %s",
+                 len(playlist), len(recommendations), fields)
+    
+    r = _build_pipeline(playlist, recommendations, limit, stages).run(executor)
+    
+    # ==========================================
+    # PREPARE FINAL RESPONSE
+    # ==========================================
+    music_graph, graph_result = r['graph']
+    dijkstra, distances = r['dijkstra']
+    genre_scores = r['scoring']
+    artist_data = r['artists']
+    recommendation_heap, top_recommendations = r.get('heap', (None, []))
+    genre_trie = r.get('trie')
+    artist_bst = r.get('bst')
+    
+    def bst_stats():
+        stats = artist_bst.get_statistics()
+        return {
+            'total_artists': stats['size'],
+            'height': stats['height'],
+            'is_balanced': stats['is_balanced'],
+            'inorder': artist_bst.inorder_traversal()[:10],
+            'min_artist': stats['min'],
+            'max_artist': stats['max']
         }
-        
-        return jsonify(response_data)
     
-    except Exception as e:
-        print(f"\n❌ Error processing request: {str(e)}")
-        import traceback
-        traceback.print_exc()
-        return jsonify({
-            'success': False,
-            'error': str(e)
-        }), 500
+    def clusters():
+        result = r['clustering'][1]
+        return {
+            'total': result['total_clusters'],
+            'sizes': result['cluster_sizes'],
+            'silhouette_score': result['silhouette_score'],
+            'silhouette_confidence': result['silhouette_confidence'],
+            'silhouette_method': result['silhouette_method']
+        }
+    
+    def algorithm_metrics():
+        clusterer, quick_sorter, merge_sorter = r['clustering'][0], r['quicksort'][0], r['mergesort'][0]
+        return {
+            'dijkstra_time': dijkstra.execution_time,
+            'clustering_time': clusterer.execution_time,
+            'quicksort_comparisons': quick_sorter.comparison_count,
+            'quicksort_time': quick_sorter.execution_time,
+            'quicksort_engine': quick_sorter.engine,
+            'mergesort_comparisons': merge_sorter.comparison_count,
+            'mergesort_time': merge_sorter.execution_time,
+            'mergesort_engine': merge_sorter.engine,
+            'graph_nodes': music_graph.node_count(),
+            'graph_edges': music_graph.edge_count(),
+            'heap_size': recommendation_heap.size()
+        }
+    
+    # Built only for the requested fields
+    sections = {
+        'orderedGenres': lambda: r['quicksort'][1],
+        'genreCounts': lambda: graph_result['genre_counts'],
+        'artistCounts': lambda: dict(list(artist_data.items())[:10]),
+        'recommendationScores': lambda: genre_scores,
+        'topRecommendations': lambda: top_recommendations,
+        'distances': lambda: distances,
+        'clusters': clusters,
+        'graphStructure': lambda: {
+            'nodes': list(graph_result['genre_counts'].keys()),
+            'edges': r['edges'],
+            'adjacency_list': music_graph.get_adjacency_list(),
+            'density': music_graph.get_graph_density()
+        },
+        'trieStats': lambda: genre_trie.get_statistics(),
+        'bstStats': bst_stats,
+        'algorithmMetrics': algorithm_metrics,
+        'insights': lambda: r['insights']
+    }
+    
+    with metrics.span('response'):
+        response_data = {'success': True}
+        for field in fields:
+            response_data[field] = sections[field]()
+        response_data['timestamp'] = datetime.now().isoformat()
+    
+    with metrics.span('serialization'):
+        body = json_io.dumps(response_data) + b'\n'
+    aggregate = r['table'][1]
+    state = {
+        'graph': music_graph,
+        'genre_scores': genre_scores,
+        'artist_counts': artist_data,
+        'genre_counts': aggregate.genre_counts,
+        'song_genre_counts': aggregate.song_genre_counts,
+        'distances': distances,
+        'heap': recommendation_heap,
+        'trie': genre_trie,
+        'bst': artist_bst
+    }
+    if session is not None:
+        session.publish(fingerprint=cache_key, **state)
+    response_cache.put(cache_key, (body, state))
+    
+    return body
 
 @app.route('/api/search-genre', methods=['POST'])
 def search_genre():
@@ -251,9 +479,9 @@ def search_genre():
         data = request.json
         prefix = data.get('prefix', '')
         
-        matches = genre_trie.search_prefix(prefix)
-        
-        print(f"🔍 Genre search for '{prefix}': {len(matches)} matches")
+        session = sessions.get(get_session_id(data))
+        with session.lock:
+            matches = session.trie.search_prefix(prefix)
         
         return jsonify({
             'success': True,
@@ -275,9 +503,9 @@ def get_artist_range():
         min_count = data.get('min_count', 0)
         max_count = data.get('max_count', float('inf'))
         
-        artists = artist_bst.range_query(min_count, max_count)
-        
-        print(f"🎤 Artist range query [{min_count}, {max_count}]: {len(artists)} results")
+        session = sessions.get(get_session_id(data))
+        with session.lock:
+            artists = session.bst.range_query(min_count, max_count)
         
         return jsonify({
             'success': True,
@@ -290,36 +518,51 @@ def get_artist_range():
             'error': str(e)
         }), 500
 
-@app.route('/api/graph-data', methods=['GET'])
-def get_graph_data():
-    """Get detailed graph structure"""
+@app.route('/api/events', methods=['POST'])
+def post_events():
+    """
+    Apply playlist change events to the caller's session
+    Body: {"events": [{"type": "song_added" | "song_removed" | "recommendation_accepted", "song": {...}}]}
+    Returns only the genres whose score changed, with their new ranks
+    """
     try:
-        adjacency_list = music_graph.get_adjacency_list()
+        data = json_io.loads(request.get_data())
+        with sessions.locked(get_session_id(data)) as session, metrics.span('events'):
+            delta = apply_events(session, data.get('events'))
         
-        nodes = []
-        links = []
+        return jsonify({'success': True, **delta})
+    
+    except PlaylistEventError as e:
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 400
+    except Exception as e:
+        logger.exception("Error applying playlist events")
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 500
+
+@app.route('/api/similar-users', methods=['POST'])
+def get_similar_users():
+    """Find users with similar playlists using MinHash/LSH"""
+    try:
+        data = request.json
+        user_id = data.get('user_id')
+        playlist = data.get('playlist', [])
+        top_k = int(data.get('top_k', 10))
         
-        for node, edges in adjacency_list.items():
-            nodes.append({
-                'id': node,
-                'label': node,
-                'degree': len(edges)
-            })
-            
-            for edge in edges:
-                links.append({
-                    'source': node,
-                    'target': edge['to'],
-                    'weight': edge['weight']
-                })
+        # Index (or refresh) this user's playlist before querying
+        if user_id is not None:
+            playlist_index.add(user_id, playlist)
+        
+        matches = playlist_index.query(playlist, top_k, exclude=user_id)
         
         return jsonify({
             'success': True,
-            'nodes': nodes,
-            'links': links,
-            'total_nodes': len(nodes),
-            'total_edges': len(links),
-            'density': music_graph.get_graph_density()
+            'matches': matches,
+            'indexed_users': playlist_index.size()
         })
     
     except Exception as e:
@@ -328,13 +571,53 @@ def get_graph_data():
             'error': str(e)
         }), 500
 
+@app.route('/api/graph-data', methods=['GET'])
+def get_graph_data():
+    """
+    Get detailed graph structure, one page at a time
+    Query: ?offset=0&limit=<nodes per page>&top_k=<edges per node>&format=json|binary
+    The body is streamed node by node; format=binary is the compact layout of utils.graph_export
+    """
+    try:
+        args = request.args
+        session = sessions.get(get_session_id())
+        try:
+            export = GraphExport(
+                session.graph,
+                offset=args.get('offset', 0, type=int),
+                limit=args.get('limit', None, type=int),
+                top_k=args.get('top_k', None, type=int),
+                lock=session.lock  # Playlist events change an owned graph in place
+            )
+        except ValueError as e:
+            return jsonify({
+                'success': False,
+                'error': str(e)
+            }), 400
+        
+        if args.get('format', 'json') == 'binary':
+            return app.response_class(export.iter_binary(), mimetype='application/octet-stream')
+        
+        body = json_io.StreamObject(export.json_members())
+        return app.response_class(json_io.iter_dumps(body), mimetype='application/json')
+    
+    except Exception as e:
+        return jsonify({
+            'success': False,
+            'error': str(e)
+        }), 500
+
 @app.route('/api/stats', methods=['GET'])
 def get_stats():
     """Get comprehensive statistics"""
     try:
+        session = sessions.get(get_session_id())
+        music_graph, recommendation_heap, genre_trie, artist_bst = session.engines()
+        
         stats = {
-            'playlist_size': len(app_data.get('playlist', [])),
-            'recommendations_size': len(app_data.get('recommendations', [])),
+            'session_id': session.session_id,
+            'playlist_size': session.playlist_size,
+            'recommendations_size': session.recommendations_size,
             'graph_stats': {
                 'nodes': music_graph.node_count(),
                 'edges': music_graph.edge_count(),
@@ -344,7 +627,10 @@ def get_stats():
             'trie_words': genre_trie.count_words(),
             'bst_size': artist_bst.size(),
             'bst_height': artist_bst.height(),
-            'last_updated': app_data.get('last_updated')
+            'last_updated': session.last_updated,
+            'response_cache': response_cache.get_statistics(),
+            'sessions': sessions.get_statistics(),
+            'stage_latency': {stage: metrics.summary(stage) for stage in sorted(metrics.histograms)}
         }
         
         return jsonify({
@@ -358,6 +644,11 @@ def get_stats():
             'error': str(e)
         }), 500
 
+@app.route('/metrics', methods=['GET'])
+def get_metrics():
+    """Per-stage latency quantiles and counters in Prometheus text format"""
+    return app.response_class(metrics.to_prometheus(), mimetype='text/plain; version=0.0.4')
+
 @app.route('/health', methods=['GET'])
 def health_check():
     """Health check endpoint"""
@@ -369,6 +660,7 @@ def health_check():
             'trie': 'initialized',
             'bst': 'initialized'
         },
+        'sessions': sessions.get_statistics()['resident'],
         'timestamp': datetime.now().isoformat()
     })
 
@@ -381,6 +673,7 @@ if __name__ == '__main__':
     print("   ✓ Max Heap (Priority Queue) - heap.py")
     print("   ✓ Trie (Genre Search) - trie.py")
     print("   ✓ Binary Search Tree (Artist Management) - bst.py")
+    print("   ✓ MinHash LSH Index (Similar Users) - playlist_lsh.py")
     print("\n🔧 Algorithms Implemented:")
     print("   ✓ Dijkstra's Shortest Path - dijkstra.py")
     print("   ✓ QuickSort - sorting.py")
@@ -391,11 +684,16 @@ if __name__ == '__main__':
     print("   - POST /api/recommend")
     print("   - POST /api/search-genre")
     print("   - POST /api/artist-range")
+    print("   - POST /api/recommend/batch")
+    print("   - POST /api/events")
+    print("   - POST /api/similar-users")
     print("   - GET  /api/graph-data")
     print("   - GET  /api/stats")
+    print("   - GET  /metrics")
     print("   - GET  /health")
     print("\n" + "=" * 70)
     print("Ready to process recommendations! 🚀")
     print("=" * 70 + "\n")
     
-    app.run(debug=True, host='0.0.0.0', port=5000)
\ No newline at end of file
+    # Engines are per session, so requests can be served in parallel
+    app.run(debug=True, host='0.0.0.0', port=5000, threaded=True)
\ No newline at end of file
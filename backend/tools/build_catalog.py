@@ -0,0 +1,53 @@
+"""
+Product Catalog Builder
+Turns a JSON dump of the product API into the binary catalog the shopping server maps at startup
+Run this from the backend folder: python -m tools.build_catalog --help
+
+    curl -o products.json 'https://dummyjson.com/products?limit=0'
+    python -m tools.build_catalog products.json data/products.catalog
+"""
+
+import os
+import sys
+import time
+import argparse
+
+from data_structures.product_catalog import ProductCatalog, write_catalog, FORMAT_VERSION
+from utils import json_io
+
+
+def read_products(path):
+    """Products of a dump: either {"products": [...]} (the API response) or a plain list"""
+    with (open(path, 'rb') if path != '-' else sys.stdin.buffer) as handle:
+        data = json_io.loads(handle.read())
+    products = data.get('products') if isinstance(data, dict) else data
+    if not isinstance(products, list):
+        raise ValueError("expected a list of products or an object with a 'products' list")
+    return products
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Build the binary product catalog from a JSON dump")
+    parser.add_argument('input', help="JSON dump of the product API ('-' for stdin)")
+    parser.add_argument('output', help="catalog file to write (replaced atomically)")
+    args = parser.parse_args(argv)
+
+    products = read_products(args.input)
+    directory = os.path.dirname(args.output)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+
+    start = time.perf_counter()
+    size = write_catalog(products, args.output)
+
+    # Read it back so a broken file is never left for the server to find
+    catalog = ProductCatalog.open(args.output)
+    if len(catalog) != len(products) or (products and catalog[len(products) - 1] != products[-1]):
+        raise SystemExit(f"Verification of {args.output} failed")
+
+    print(f"Wrote {len(products)} products ({size} bytes, format v{FORMAT_VERSION}) to {args.output} "
+          f"in {time.perf_counter() - start:.3f}s", file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,97 @@
+"""
+Playlist Aggregation Utility
+One columnar pass over playlist + recommendations whose counts every pipeline stage shares
+"""
+
+from collections import Counter
+
+from data_structures.song_table import SongTable
+
+# Recommendations count double everywhere in the pipeline
+PLAYLIST_WEIGHT = 1
+RECOMMENDATION_WEIGHT = 2
+
+class PlaylistAggregate:
+    """
+    Counters (keys are display labels, 'Unknown' for a missing key):
+        genre_counts / artist_counts  - weighted (playlist 1, recommendations 2), empty values skipped
+        song_genre_counts             - one per song, empty genres skipped (graph nodes)
+        playlist_genres / playlist_artists / recommendation_genres - unweighted labels
+        album_counts                  - unweighted labels over all songs
+    Counting runs over the interned id columns of a SongTable, labels are resolved once per distinct value
+    """
+    def __init__(self, table):
+        self.table = table
+        self.playlist_size = table.playlist_size
+        self.recommendations_size = table.recommendations_size
+        
+        p = table.playlist_size
+        genres = table.column('genre')
+        artists = table.column('artist')
+        
+        playlist_genre_ids = Counter(genres[:p])
+        playlist_artist_ids = Counter(artists[:p])
+        rec_genre_ids = Counter(genres[p:])
+        rec_artist_ids = Counter(artists[p:])
+        
+        self.playlist_genres = self._labels(table, 'genre', playlist_genre_ids)
+        self.playlist_artists = self._labels(table, 'artist', playlist_artist_ids)
+        self.recommendation_genres = self._labels(table, 'genre', rec_genre_ids)
+        self.album_counts = self._labels(table, 'album', Counter(table.column('album')))
+        
+        self.genre_counts = self._weighted(table, 'genre', playlist_genre_ids, rec_genre_ids)
+        self.artist_counts = self._weighted(table, 'artist', playlist_artist_ids, rec_artist_ids)
+        self.song_genre_counts = self._weighted(table, 'genre', playlist_genre_ids, rec_genre_ids,
+                                                recommendation_weight=PLAYLIST_WEIGHT)
+        
+        self.genre_diversity = self.diversity(self.playlist_genres, self.playlist_size)
+        self.artist_diversity = self.diversity(self.playlist_artists, self.playlist_size)
+    
+    @classmethod
+    def from_songs(cls, playlist, recommendations):
+        """Aggregate raw song dicts (builds the SongTable first)"""
+        return cls(SongTable.from_payload(playlist, recommendations))
+    
+    @staticmethod
+    def _labels(table, field, id_counts):
+        """{value id: count} -> {label: count}"""
+        pool = table.pools[field]
+        counts = Counter()
+        for value_id, count in id_counts.items():
+            counts[pool.label(value_id)] += count
+        return counts
+    
+    @staticmethod
+    def _weighted(table, field, playlist_ids, recommendation_ids,
+                  recommendation_weight=RECOMMENDATION_WEIGHT):
+        """Weighted counts of non-empty values, playlist values first"""
+        pool = table.pools[field]
+        counts = Counter()
+        for id_counts, weight in ((playlist_ids, PLAYLIST_WEIGHT),
+                                  (recommendation_ids, recommendation_weight)):
+            for value_id, count in id_counts.items():
+                if pool.has_value(value_id):
+                    counts[pool.value(value_id)] += count * weight
+        return counts
+    
+    @staticmethod
+    def diversity(counter, total):
+        """
+        Calculate Shannon diversity index
+        Higher value means more diverse
+        """
+        if total == 0:
+            return 0
+
+        # Shannon entropy
+        diversity = 0
+        for count in counter.values():
+            proportion = count / total
+            if proportion > 0:
+                diversity -= proportion * (proportion ** 0.5)  # Simplified
+
+        return round(diversity, 3)
+
+    def total_weight(self):
+        """Sum of weighted genre counts"""
+        return sum(self.genre_counts.values())
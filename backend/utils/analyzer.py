@@ -5,27 +5,32 @@ Provides analysis functions for music data
 
 from collections import Counter, defaultdict
 
+from data_structures.feature_store import default_feature_store
+from data_structures.song_index import SongIndex
+from utils.aggregation import PlaylistAggregate
+
 class MusicAnalyzer:
-    def __init__(self):
-        pass
+    def __init__(self, feature_store=None):
+        self.feature_store = feature_store or default_feature_store
+    
+    def aggregate(self, playlist, recommendations, table=None):
+        """Build the shared aggregate for one request (from its SongTable when there is one)"""
+        if table is not None:
+            return PlaylistAggregate(table)
+        return PlaylistAggregate.from_songs(playlist, recommendations)
     
-    def calculate_genre_scores(self, playlist, recommendations, distances):
+    def calculate_genre_scores(self, playlist, recommendations, distances, aggregate=None):
         """
         Calculate recommendation scores for each genre
         Score = frequency / (1 + distance)
         """
-        # Count genres
-        genre_counts = Counter()
-        
-        for song in playlist:
-            if song.get('genre'):
-                genre_counts[song['genre']] += 1
-        
-        for song in recommendations:
-            if song.get('genre'):
-                genre_counts[song['genre']] += 2  # Weight recommendations higher
-        
-        # Calculate scores using distances
+        # Weighted genre counts (recommendations count double)
+        aggregate = aggregate or self.aggregate(playlist, recommendations)
+        return self.score_genres(aggregate.genre_counts, distances)
+    
+    @staticmethod
+    def score_genres(genre_counts, distances):
+        """Score = count / (1 + distance) for every counted genre"""
         scores = {}
         for genre, count in genre_counts.items():
             distance = distances.get(genre, float('inf'))
@@ -36,114 +41,69 @@ class MusicAnalyzer:
         
         return scores
     
-    def analyze_artists(self, playlist, recommendations):
+    def analyze_artists(self, playlist, recommendations, aggregate=None):
         """Analyze artist frequencies"""
-        artist_counts = Counter()
-        
-        for song in playlist:
-            if song.get('artist'):
-                artist_counts[song['artist']] += 1
-        
-        for song in recommendations:
-            if song.get('artist'):
-                artist_counts[song['artist']] += 2
-        
-        return dict(artist_counts)
+        aggregate = aggregate or self.aggregate(playlist, recommendations)
+        return dict(aggregate.artist_counts)
     
-    def analyze_temporal_patterns(self, playlist):
+    def analyze_temporal_patterns(self, playlist, aggregate=None):
         """Analyze when songs were added"""
+        aggregate = aggregate or self.aggregate(playlist, [])
+        
         patterns = {
-            'total_songs': len(playlist),
-            'genres_distribution': self._genre_distribution(playlist),
-            'artist_diversity': self._calculate_diversity(playlist, 'artist'),
-            'genre_diversity': self._calculate_diversity(playlist, 'genre')
+            'total_songs': aggregate.playlist_size,
+            'genres_distribution': self._genre_distribution(aggregate),
+            'artist_diversity': aggregate.artist_diversity,
+            'genre_diversity': aggregate.genre_diversity
         }
         
         return patterns
     
-    def _genre_distribution(self, songs):
-        """Calculate genre distribution"""
-        genres = [song.get('genre', 'Unknown') for song in songs]
-        counter = Counter(genres)
+    def _genre_distribution(self, aggregate):
+        """Calculate playlist genre distribution"""
+        counter = aggregate.playlist_genres
         
         return {
             'counts': dict(counter),
             'percentages': {
-                genre: round(count / len(songs) * 100, 2)
+                genre: round(count / aggregate.playlist_size * 100, 2)
                 for genre, count in counter.items()
             }
         }
     
-    def _calculate_diversity(self, songs, field):
-        """
-        Calculate Shannon diversity index
-        Higher value means more diverse
-        """
-        values = [song.get(field, 'Unknown') for song in songs]
-        counter = Counter(values)
-        
-        total = len(values)
-        if total == 0:
-            return 0
-        
-        # Shannon entropy
-        diversity = 0
-        for count in counter.values():
-            proportion = count / total
-            if proportion > 0:
-                diversity -= proportion * (proportion ** 0.5)  # Simplified
-        
-        return round(diversity, 3)
+    def build_song_index(self, all_songs):
+        """Build posting lists once so repeated similarity lookups skip the full scan"""
+        return SongIndex(self.feature_store).build(all_songs)
     
-    def find_similar_songs(self, target_song, all_songs, top_k=5):
+    def find_similar_songs(self, target_song, all_songs, top_k=5, index=None):
         """
         Find songs similar to target song
-        Based on genre and artist matching
+        Based on genre (3), artist (2) and album (1) matching, ties broken by feature-vector distance
+        Pass an index from build_song_index to avoid re-indexing all_songs on every call
         """
-        target_genre = target_song.get('genre', '')
-        target_artist = target_song.get('artist', '')
-        
-        similarities = []
-        
-        for song in all_songs:
-            if song.get('id') == target_song.get('id'):
-                continue
-            
-            score = 0
-            
-            # Genre match (weight: 3)
-            if song.get('genre') == target_genre:
-                score += 3
-            
-            # Artist match (weight: 2)
-            if song.get('artist') == target_artist:
-                score += 2
-            
-            # Same album (weight: 1)
-            if song.get('album') == target_song.get('album'):
-                score += 1
-            
-            if score > 0:
-                similarities.append({
-                    'song': song,
-                    'similarity_score': score
-                })
-        
-        # Sort by similarity score
-        similarities.sort(key=lambda x: x['similarity_score'], reverse=True)
+        index = index or self.build_song_index(all_songs)
         
-        return similarities[:top_k]
+        return [
+            {
+                'song': song,
+                'similarity_score': score,
+                'distance': self.feature_store.distance(target_song, song)
+            }
+            for score, song in index.similar(target_song, top_k)
+        ]
     
-    def calculate_listening_score(self, playlist):
+    def calculate_listening_score(self, playlist, aggregate=None):
         """
         Calculate overall listening score based on diversity and variety
         """
         if not playlist:
             return 0
         
+        aggregate = aggregate or self.aggregate(playlist, [])
+        
         scores = {
-            'diversity': self._calculate_diversity(playlist, 'genre') * 20,
-            'artist_variety': self._calculate_diversity(playlist, 'artist') * 15,
+            'diversity': aggregate.genre_diversity * 20,
+            'artist_variety': aggregate.artist_diversity * 15,
             'size_bonus': min(len(playlist) / 10, 10),  # Max 10 points
         }
         
@@ -168,21 +128,22 @@ class MusicAnalyzer:
         else:
             return 'Limited'
     
-    def generate_insights(self, playlist, recommendations):
+    def generate_insights(self, playlist, recommendations, aggregate=None):
         """Generate insights about music preferences"""
         insights = []
+        aggregate = aggregate or self.aggregate(playlist, recommendations)
         
         # Genre insights
-        genre_counts = Counter(song.get('genre', 'Unknown') for song in playlist)
+        genre_counts = aggregate.playlist_genres
         if genre_counts:
             top_genre = genre_counts.most_common(1)[0]
             insights.append({
                 'type': 'genre_preference',
-                'message': f"You love {top_genre[0]}! It makes up {round(top_genre[1]/len(playlist)*100)}% of your playlist."
+                'message': f"You love {top_genre[0]}! It makes up {round(top_genre[1]/aggregate.playlist_size*100)}% of your playlist."
             })
         
         # Artist insights
-        artist_counts = Counter(song.get('artist', 'Unknown') for song in playlist)
+        artist_counts = aggregate.playlist_artists
         if len(artist_counts) > 5:
             insights.append({
                 'type': 'artist_diversity',
@@ -190,8 +151,8 @@ class MusicAnalyzer:
             })
         
         # Recommendations insights
-        if recommendations:
-            rec_genres = Counter(song.get('genre', 'Unknown') for song in recommendations)
+        if aggregate.recommendations_size:
+            rec_genres = aggregate.recommendation_genres
             if rec_genres:
                 top_rec = rec_genres.most_common(1)[0]
                 insights.append({
@@ -217,30 +178,21 @@ class MusicAnalyzer:
             'similarity_score': round(len(common_genres) / len(genres1.union(genres2)) * 100, 2) if genres1.union(genres2) else 0
         }
     
-    def predict_next_preference(self, playlist, recommendations):
+    def predict_next_preference(self, playlist, recommendations, aggregate=None):
         """Predict what genre user might like next"""
-        # Combine all data
-        all_genres = []
-        
-        for song in playlist:
-            if song.get('genre'):
-                all_genres.append(song['genre'])
+        # Weighted genre counts (recommendations count double)
+        aggregate = aggregate or self.aggregate(playlist, recommendations)
+        genre_counts = aggregate.genre_counts
+        total = aggregate.total_weight()
         
-        for song in recommendations:
-            if song.get('genre'):
-                all_genres.extend([song['genre']] * 2)  # Weight recommendations
-        
-        if not all_genres:
+        if not total:
             return None
         
-        # Find most common
-        genre_counts = Counter(all_genres)
-        
         # Get top 3
         top_genres = genre_counts.most_common(3)
         
         return {
             'primary_prediction': top_genres[0][0] if top_genres else None,
-            'confidence': round(top_genres[0][1] / len(all_genres) * 100, 2) if top_genres else 0,
+            'confidence': round(top_genres[0][1] / total * 100, 2) if top_genres else 0,
             'alternatives': [g[0] for g in top_genres[1:]]
         }
\ No newline at end of file
@@ -0,0 +1,196 @@
+"""
+Graph Export Utility
+Paginated, streamed export of a genre graph as JSON or as a compact binary encoding
+
+Nodes are numbered by sorted name; a page covers the source nodes [offset, offset + limit).
+With top_k, each node keeps only its k lightest edges (weight = 1 + |count difference|, so the
+lightest edges join genres of similar size).
+
+Binary layout (little endian, varint = unsigned LEB128):
+    b'LLG1'
+    varint total_nodes, varint offset, varint page_nodes, varint next_offset (0 on the last page)
+    f64 weight_min, f64 weight_step      weight = weight_min + q * weight_step
+    varint name_count                    total_nodes on the first page, 0 on later ones
+    name_count x (varint byte_length, UTF-8 name)
+    page_nodes x:
+        varint edge_count
+        edge_count x (varint target_id delta, u16 q)   targets ascending, first delta from 0
+"""
+
+import heapq
+import struct
+from contextlib import nullcontext
+
+MAGIC = b'LLG1'
+WEIGHT_LEVELS = 0xFFFF  # Weights are quantized to 16 bits over the graph's [min, max] range
+
+
+def encode_varint(value):
+    """Unsigned LEB128"""
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def decode_varint(data, pos):
+    """Unsigned LEB128 at data[pos], returns (value, next position)"""
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+class GraphExport:
+    """
+    One page of a MusicGraph export
+    Node ids and the weight range are fixed when the export is created; edges are read one
+    source node at a time (under `lock` when given), so the body is never built as a whole
+    """
+    def __init__(self, graph, offset=0, limit=None, top_k=None, lock=None):
+        if offset < 0 or (limit is not None and limit < 1) or (top_k is not None and top_k < 1):
+            raise ValueError("offset must be >= 0, limit and top_k must be >= 1")
+
+        self.graph = graph
+        self.top_k = top_k
+        self.lock = lock
+
+        with self._locked():
+            self.names = sorted(graph.nodes, key=str)
+            weights = [edge['weight'] for edges in graph.adjacency_list.values() for edge in edges]
+            self.total_edges = len(weights)
+            self.density = graph.get_graph_density()
+
+        self.ids = {name: index for index, name in enumerate(self.names)}
+        self.total_nodes = len(self.names)
+        self.offset = min(offset, self.total_nodes)
+        end = self.total_nodes if limit is None else min(self.total_nodes, self.offset + limit)
+        self.page = self.names[self.offset:end]
+        self.next_offset = end if end < self.total_nodes else None
+
+        self.weight_min = min(weights, default=0)
+        span = max(weights, default=0) - self.weight_min
+        self.weight_step = span / WEIGHT_LEVELS if span else 1.0
+
+    def _locked(self):
+        return self.lock if self.lock is not None else nullcontext()
+
+    def edges_of(self, node):
+        """(degree, selected edges) of a source node, lightest first with top_k"""
+        with self._locked():
+            edges = list(self.graph.adjacency_list.get(node, ()))
+        selected = [edge for edge in edges if edge['to'] in self.ids]
+        if self.top_k is not None and len(selected) > self.top_k:
+            selected = heapq.nsmallest(self.top_k, selected, key=lambda edge: (edge['weight'], str(edge['to'])))
+        return len(edges), selected
+
+    # ---------------- JSON ----------------
+
+    def json_members(self):
+        """(key, value) pairs for json_io.StreamObject; nodes and links are generators"""
+        degrees = {}
+
+        def links():
+            for node in self.page:
+                degrees[node], edges = self.edges_of(node)
+                for edge in edges:
+                    yield {'source': node, 'target': edge['to'], 'weight': edge['weight']}
+
+        def nodes():
+            for node in self.page:
+                if node not in degrees:
+                    degrees[node] = self.edges_of(node)[0]
+                yield {'id': node, 'label': node, 'degree': degrees[node]}
+
+        return [
+            ('density', self.density),
+            ('links', links()),
+            ('next_offset', self.next_offset),
+            ('nodes', nodes()),
+            ('offset', self.offset),
+            ('success', True),
+            ('top_k', self.top_k),
+            ('total_edges', self.total_edges),
+            ('total_nodes', self.total_nodes)
+        ]
+
+    # ---------------- BINARY ----------------
+
+    def quantize(self, weight):
+        return min(WEIGHT_LEVELS, max(0, round((weight - self.weight_min) / self.weight_step)))
+
+    def iter_binary(self):
+        """The page in the binary layout, one chunk per source node"""
+        header = bytearray(MAGIC)
+        for value in (self.total_nodes, self.offset, len(self.page), self.next_offset or 0):
+            header += encode_varint(value)
+        header += struct.pack('<dd', self.weight_min, self.weight_step)
+
+        names = self.names if self.offset == 0 else []
+        header += encode_varint(len(names))
+        for name in names:
+            encoded = str(name).encode('utf-8')
+            header += encode_varint(len(encoded)) + encoded
+        yield bytes(header)
+
+        for node in self.page:
+            _, edges = self.edges_of(node)
+            targets = sorted((self.ids[edge['to']], self.quantize(edge['weight'])) for edge in edges)
+
+            chunk = bytearray(encode_varint(len(targets)))
+            previous = 0
+            for target, q in targets:
+                chunk += encode_varint(target - previous)
+                chunk += struct.pack('<H', q)
+                previous = target
+            yield bytes(chunk)
+
+
+def decode_binary(data, names=None):
+    """
+    Decode one binary page (used by tests and Python clients)
+    Returns {'total_nodes', 'offset', 'next_offset', 'names', 'edges': [(source, target, weight)]};
+    pages after the first need the names of the first one
+    """
+    if data[:4] != MAGIC:
+        raise ValueError("Not a graph export")
+    pos = 4
+    total_nodes, pos = decode_varint(data, pos)
+    offset, pos = decode_varint(data, pos)
+    page_nodes, pos = decode_varint(data, pos)
+    next_offset, pos = decode_varint(data, pos)
+    weight_min, weight_step = struct.unpack_from('<dd', data, pos)
+    pos += 16
+
+    name_count, pos = decode_varint(data, pos)
+    if name_count:
+        names = []
+        for _ in range(name_count):
+            length, pos = decode_varint(data, pos)
+            names.append(data[pos:pos + length].decode('utf-8'))
+            pos += length
+
+    edges = []
+    for source in range(offset, offset + page_nodes):
+        count, pos = decode_varint(data, pos)
+        target = 0
+        for _ in range(count):
+            delta, pos = decode_varint(data, pos)
+            target += delta
+            q, = struct.unpack_from('<H', data, pos)
+            pos += 2
+            edges.append((names[source], names[target], weight_min + q * weight_step))
+
+    return {
+        'total_nodes': total_nodes,
+        'offset': offset,
+        'next_offset': next_offset or None,
+        'names': names,
+        'edges': edges
+    }
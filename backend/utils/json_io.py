@@ -0,0 +1,96 @@
+"""
+JSON I/O Utility
+Fast parse/serialize path for recommendation payloads, plus a streaming writer for large responses
+Uses orjson when it is installed and falls back to the standard json module otherwise
+"""
+
+import json
+
+try:
+    import orjson
+except ImportError:  # Optional native backend
+    orjson = None
+
+BACKEND = 'orjson' if orjson is not None else 'json'
+
+# Containers with at least this many items are streamed element by element
+STREAM_MIN_ITEMS = 64
+
+
+def loads(data):
+    """Parse a JSON document from bytes or str"""
+    if orjson is not None:
+        return orjson.loads(data)
+    if isinstance(data, (bytes, bytearray)):
+        data = data.decode('utf-8')
+    return json.loads(data)
+
+
+def dumps(obj):
+    """
+    Serialize to compact UTF-8 bytes with sorted keys (same key order as Flask's jsonify)
+    Note: orjson writes non-finite floats as null where json writes Infinity/NaN
+    """
+    if orjson is not None:
+        return orjson.dumps(obj, option=orjson.OPT_SORT_KEYS | orjson.OPT_NON_STR_KEYS)
+    return json.dumps(obj, sort_keys=True, separators=(',', ':')).encode('utf-8')
+
+
+def iter_dumps(obj):
+    """
+    Serialize as a stream of byte chunks
+    Large dicts and lists (and generators) are written one item at a time, so a response
+    can be produced straight from a data structure without building it as a whole first
+    """
+    if isinstance(obj, StreamObject):
+        yield from iter_object(obj.items, sort_keys=False)
+    elif _is_lazy(obj):
+        yield from iter_array(obj)
+    elif isinstance(obj, dict) and (len(obj) >= STREAM_MIN_ITEMS or any(map(_is_lazy, obj.values()))):
+        yield from iter_object(obj.items(), sort_keys=True)
+    elif isinstance(obj, (list, tuple)) and (len(obj) >= STREAM_MIN_ITEMS or any(map(_is_lazy, obj))):
+        yield from iter_array(obj)
+    else:
+        yield dumps(obj)
+
+
+def _is_lazy(value):
+    """Generators and StreamObjects cannot go through dumps() and must be streamed"""
+    return isinstance(value, StreamObject) or hasattr(value, '__next__')
+
+
+def iter_array(items):
+    """Stream a JSON array from any iterable"""
+    yield b'['
+    first = True
+    for item in items:
+        if not first:
+            yield b','
+        first = False
+        yield from iter_dumps(item)
+    yield b']'
+
+
+def iter_object(items, sort_keys=True):
+    """Stream a JSON object from (key, value) pairs"""
+    if sort_keys:
+        items = sorted(items, key=lambda pair: str(pair[0]))
+    yield b'{'
+    first = True
+    for key, value in items:
+        if not first:
+            yield b','
+        first = False
+        yield dumps(str(key))
+        yield b':'
+        yield from iter_dumps(value)
+    yield b'}'
+
+
+class StreamObject:
+    """
+    A JSON object whose members are produced lazily, in the given order
+    Values may be generators, which are streamed as arrays
+    """
+    def __init__(self, items):
+        self.items = items
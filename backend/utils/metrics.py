@@ -0,0 +1,197 @@
+"""
+Metrics Utility
+Per-stage latency spans recorded into HDR-style histograms, exported in Prometheus text format
+"""
+
+import time
+import weakref
+import threading
+from contextlib import contextmanager
+
+class LatencyHistogram:
+    """
+    Log-linear (HDR-style) histogram of durations in microseconds
+    Every power-of-two range is split into linear buckets, so a reported value is off by at
+    most 1/64 (about 1.6%) of the recorded one.
+    Each thread records into its own sparse shard ({bucket: count}), so recording never takes
+    a lock; shards are summed when the histogram is read. Shards of finished threads (Flask
+    starts one per request) are folded into a base shard on reads, or by a registering thread
+    once more than PRUNE_THRESHOLD have piled up between reads
+    """
+    SUB_BUCKET_BITS = 7
+    SUB_BUCKETS = 1 << SUB_BUCKET_BITS
+    HALF = SUB_BUCKETS // 2  # Linear buckets per power of two above SUB_BUCKETS
+    MAX_SHIFT = 34  # Values up to 2^41 us (about 25 days)
+    PRUNE_THRESHOLD = 1024
+
+    def __init__(self):
+        self.size = self.SUB_BUCKETS + self.MAX_SHIFT * self.HALF
+        self._local = threading.local()
+        self._base = self._new_shard()  # Merged shards of finished threads
+        self._shards = {}  # id(shard) -> (weakref to owning thread, shard)
+        self._prune_lock = threading.Lock()  # Only taken by readers (and the rare overflow prune)
+
+    @staticmethod
+    def _new_shard():
+        return {'counts': {}, 'count': 0, 'sum': 0.0, 'max': 0}
+
+    def _shard(self):
+        shard = getattr(self._local, 'shard', None)
+        if shard is None:
+            shard = self._new_shard()
+            # A single dict store is atomic, so registering needs no lock either
+            self._shards[id(shard)] = (weakref.ref(threading.current_thread()), shard)
+            self._local.shard = shard
+            if len(self._shards) > self.PRUNE_THRESHOLD and self._prune_lock.acquire(blocking=False):
+                try:
+                    self._prune()
+                finally:
+                    self._prune_lock.release()
+        return shard
+
+    def _prune(self):
+        """Fold shards of finished threads into the base shard (prune lock held)"""
+        for key, (owner, shard) in self._shards.copy().items():
+            thread = owner()
+            if thread is None or not thread.is_alive():
+                self._merge(self._base, shard)  # Its thread is gone, so it no longer changes
+                del self._shards[key]
+
+    @staticmethod
+    def _merge(target, shard):
+        counts = target['counts']
+        for index, value in shard['counts'].copy().items():
+            counts[index] = counts.get(index, 0) + value
+        target['count'] += shard['count']
+        target['sum'] += shard['sum']
+        target['max'] = max(target['max'], shard['max'])
+
+    def _index(self, micros):
+        """Bucket of a value: exact below SUB_BUCKETS, then HALF linear buckets per power of two"""
+        if micros < self.SUB_BUCKETS:
+            return micros
+        shift = min(micros.bit_length() - self.SUB_BUCKET_BITS, self.MAX_SHIFT)
+        top = min(micros >> shift, self.SUB_BUCKETS - 1)  # In [HALF, SUB_BUCKETS)
+        return self.SUB_BUCKETS + (shift - 1) * self.HALF + (top - self.HALF)
+
+    def _value_at(self, index):
+        """Upper bound (in microseconds) of the values in a bucket"""
+        if index < self.SUB_BUCKETS:
+            return index
+        shift = (index - self.SUB_BUCKETS) // self.HALF + 1
+        top = (index - self.SUB_BUCKETS) % self.HALF + self.HALF
+        return ((top + 1) << shift) - 1
+
+    def record(self, seconds):
+        """Record one duration"""
+        micros = max(0, int(seconds * 1000000))
+        shard = self._shard()
+        counts = shard['counts']
+        index = self._index(micros)
+        counts[index] = counts.get(index, 0) + 1
+        shard['count'] += 1
+        shard['sum'] += seconds
+        if micros > shard['max']:
+            shard['max'] = micros
+
+    def snapshot(self):
+        """Merged counts of every shard: (counts, count, sum_seconds, max_micros)"""
+        merged = self._new_shard()
+        with self._prune_lock:
+            self._prune()
+            self._merge(merged, self._base)
+            shards = [shard for _, shard in self._shards.copy().values()]
+        for shard in shards:
+            self._merge(merged, shard)
+
+        counts = [0] * self.size
+        for index, value in merged['counts'].items():
+            counts[index] = value
+        return counts, merged['count'], merged['sum'], merged['max']
+
+    def percentiles(self, fractions):
+        """{fraction: seconds} for each fraction in [0, 1]"""
+        counts, count, _, maximum = self.snapshot()
+        result = {}
+        if count == 0:
+            return {fraction: 0.0 for fraction in fractions}
+
+        for fraction in fractions:
+            target = max(1, int(round(fraction * count)))
+            seen = 0
+            for index, value in enumerate(counts):
+                seen += value
+                if seen >= target:
+                    result[fraction] = min(self._value_at(index), maximum) / 1000000
+                    break
+        return result
+
+
+class MetricsRegistry:
+    """
+    Named latency histograms (one per pipeline stage) plus callables sampled at export time
+    """
+    QUANTILES = (0.5, 0.9, 0.99)
+
+    def __init__(self, prefix='linklab'):
+        self.prefix = prefix
+        self.histograms = {}  # stage -> LatencyHistogram
+        self.gauges = {}  # name -> (help, callable returning a number)
+        self._lock = threading.Lock()
+
+    def histogram(self, stage):
+        """Histogram of a stage, created on first use"""
+        histogram = self.histograms.get(stage)
+        if histogram is None:
+            with self._lock:
+                histogram = self.histograms.setdefault(stage, LatencyHistogram())
+        return histogram
+
+    @contextmanager
+    def span(self, stage):
+        """Time a block of code as one span of a stage"""
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.histogram(stage).record(time.perf_counter() - start)
+
+    def gauge(self, name, help_text, read):
+        """Register a value sampled on every export"""
+        self.gauges[name] = (help_text, read)
+
+    def summary(self, stage):
+        """p50/p90/p99, count and mean of a stage (seconds)"""
+        histogram = self.histogram(stage)
+        _, count, total, _ = histogram.snapshot()
+        quantiles = histogram.percentiles(self.QUANTILES)
+        return {
+            'count': count,
+            'mean': total / count if count else 0.0,
+            'p50': quantiles[0.5],
+            'p90': quantiles[0.9],
+            'p99': quantiles[0.99]
+        }
+
+    def to_prometheus(self):
+        """Prometheus text exposition format (version 0.0.4)"""
+        name = f'{self.prefix}_stage_duration_seconds'
+        lines = [
+            f'# HELP {name} Duration of recommendation pipeline stages',
+            f'# TYPE {name} summary'
+        ]
+        for stage in sorted(self.histograms):
+            histogram = self.histograms[stage]
+            _, count, total, _ = histogram.snapshot()
+            for quantile, value in histogram.percentiles(self.QUANTILES).items():
+                lines.append(f'{name}{{stage="{stage}",quantile="{quantile}"}} {value:.6f}')
+            lines.append(f'{name}_sum{{stage="{stage}"}} {total:.6f}')
+            lines.append(f'{name}_count{{stage="{stage}"}} {count}')
+
+        for gauge in sorted(self.gauges):
+            help_text, read = self.gauges[gauge]
+            lines.append(f'# HELP {self.prefix}_{gauge} {help_text}')
+            lines.append(f'# TYPE {self.prefix}_{gauge} gauge')
+            lines.append(f'{self.prefix}_{gauge} {read()}')
+
+        return '\n'.join(lines) + '\n'
@@ -0,0 +1,80 @@
+"""
+Stage Pipeline Utility
+Runs named stages as a dependency DAG, starting every stage as soon as its inputs are ready
+"""
+
+from contextlib import nullcontext
+from concurrent.futures import ThreadPoolExecutor, wait, FIRST_COMPLETED
+
+class StagePipeline:
+    """
+    Each stage is fn(results) -> value, where results maps finished stage names to their values
+    A stage only reads the stages it lists as dependencies; independent stages run concurrently
+    on the executor and the caller gets every result back once all of them have finished
+    """
+    def __init__(self, span=None):
+        self.stages = {}  # name -> (fn, dependencies), in insertion order
+        self.span = span  # Optional span(name) context manager wrapped around every stage
+
+    def add(self, name, fn, deps=()):
+        """Register a stage; dependencies must already be registered"""
+        if name in self.stages:
+            raise ValueError(f"Duplicate stage: {name}")
+        missing = [dep for dep in deps if dep not in self.stages]
+        if missing:
+            raise ValueError(f"Stage {name} depends on unknown stages: {', '.join(missing)}")
+        self.stages[name] = (fn, tuple(deps))
+        return self
+
+    def _run_stage(self, name, results):
+        fn, _ = self.stages[name]
+        with (self.span(name) if self.span else nullcontext()):
+            return fn(results)
+
+    def run(self, executor=None):
+        """
+        Execute every stage and return {name: value}
+        Without an executor the stages run one after another in insertion (topological) order.
+        The first failing stage cancels whatever has not started and its exception is re-raised
+        """
+        results = {}
+        if executor is None:
+            for name in self.stages:
+                results[name] = self._run_stage(name, results)
+            return results
+
+        waiting = {name: set(deps) for name, (_, deps) in self.stages.items()}
+        dependents = {name: [] for name in self.stages}
+        for name, deps in waiting.items():
+            for dep in deps:
+                dependents[dep].append(name)
+
+        running = {}  # future -> stage name
+
+        def submit_ready():
+            for name in [n for n, deps in waiting.items() if not deps]:
+                del waiting[name]
+                # Stages only see a snapshot holding their finished dependencies
+                running[executor.submit(self._run_stage, name, dict(results))] = name
+
+        submit_ready()
+        try:
+            while running:
+                done, _ = wait(running, return_when=FIRST_COMPLETED)
+                for future in done:
+                    name = running.pop(future)
+                    results[name] = future.result()
+                    for dependent in dependents[name]:
+                        waiting[dependent].discard(name)
+                submit_ready()
+        except BaseException:
+            for future in running:
+                future.cancel()
+            raise
+
+        return results
+
+
+def create_stage_executor(max_workers=4, name='stage'):
+    """Thread pool shared by every pipeline run (or batch) of a server"""
+    return ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix=name)
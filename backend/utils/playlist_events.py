@@ -0,0 +1,164 @@
+"""
+Playlist Events Utility
+Applies incremental playlist changes to a session's engines instead of recomputing the pipeline
+"""
+
+from datetime import datetime
+
+from algorithms.dijkstra import DijkstraAlgorithm
+from utils.analyzer import MusicAnalyzer
+
+# Event type -> (playlist delta, recommendations delta) of the song it carries
+EVENT_TYPES = {
+    'song_added': (1, 0),
+    'song_removed': (-1, 0),
+    'recommendation_accepted': (1, -1),  # Moves a song from recommendations into the playlist
+}
+
+# Recommendations count double, like in PlaylistAggregate
+RECOMMENDATION_WEIGHT = 2
+
+
+class PlaylistEventError(ValueError):
+    """Raised for a malformed event batch (nothing is applied)"""
+
+
+def song_key(song):
+    """Songs are matched by id, falling back to their descriptive fields"""
+    if song.get('id') is not None:
+        return song['id']
+    return (song.get('title'), song.get('artist'), song.get('genre'), song.get('album'))
+
+
+def validate_events(events):
+    """Check every event before any of them is applied"""
+    if not isinstance(events, list) or not events:
+        raise PlaylistEventError("events must be a non-empty list")
+
+    for index, event in enumerate(events):
+        if not isinstance(event, dict) or event.get('type') not in EVENT_TYPES:
+            raise PlaylistEventError(f"event {index}: type must be one of {', '.join(EVENT_TYPES)}")
+        if not isinstance(event.get('song'), dict):
+            raise PlaylistEventError(f"event {index}: song object is required")
+
+
+def _take(songs, song):
+    """Remove and return the stored copy of a song from a list (None if absent)"""
+    key = song_key(song)
+    for index, stored in enumerate(songs):
+        if song_key(stored) == key:
+            return songs.pop(index)
+    return None
+
+
+def apply_events(session, events):
+    """
+    Apply a batch of events to a session (the caller holds session.lock)
+    Counts, graph edges of the touched genres, heap scores, trie words and BST nodes are
+    updated in place; Dijkstra reruns on the (genre-sized) graph.
+    Returns the delta: changed and removed genre scores plus their new ranks
+    """
+    validate_events(events)
+    session.take_ownership()
+
+    old_scores = session.genre_scores
+    old_artist_counts = dict(session.artist_counts)
+    touched_genres = set()
+    touched_artists = set()
+    skipped = []
+
+    for index, event in enumerate(events):
+        song = event['song']
+        playlist_delta, recommendation_delta = EVENT_TYPES[event['type']]
+
+        # Removals and accepts must match a stored song; use its stored fields for the counts.
+        # A session restored from a snapshot has no song lists, so the event's fields are trusted
+        if event['type'] == 'song_removed':
+            has_songs = len(session.playlist) == session.playlist_size
+            stored = _take(session.playlist, song)
+            if stored is None and has_songs:
+                skipped.append(index)
+                continue
+            song = stored or song
+        elif event['type'] == 'recommendation_accepted':
+            has_songs = len(session.recommendations) == session.recommendations_size
+            stored = _take(session.recommendations, song)
+            if stored is None and has_songs:
+                skipped.append(index)
+                continue
+            song = stored or song
+            session.playlist.append(song)
+        else:
+            session.playlist.append(song)
+
+        session.playlist_size = max(0, session.playlist_size + playlist_delta)
+        session.recommendations_size = max(0, session.recommendations_size + recommendation_delta)
+
+        weighted = playlist_delta + RECOMMENDATION_WEIGHT * recommendation_delta
+        genre = song.get('genre')
+        if genre:
+            session.genre_counts[genre] += weighted
+            session.song_genre_counts[genre] += playlist_delta + recommendation_delta
+            touched_genres.add(genre)
+
+        artist = song.get('artist')
+        if artist:
+            session.artist_counts[artist] = session.artist_counts.get(artist, 0) + weighted
+            touched_artists.add(artist)
+
+    # Graph: only the touched genres' edges are re-weighted
+    graph = session.graph
+    for genre in touched_genres:
+        if session.genre_counts[genre] <= 0:
+            del session.genre_counts[genre]
+        if session.song_genre_counts[genre] <= 0:
+            del session.song_genre_counts[genre]
+        graph.set_genre_count(genre, session.song_genre_counts.get(genre, 0) + session.genre_counts.get(genre, 0))
+
+    for artist in touched_artists:
+        if session.artist_counts[artist] <= 0:
+            del session.artist_counts[artist]
+
+    distances = DijkstraAlgorithm(graph).compute_shortest_paths()
+    new_scores = MusicAnalyzer.score_genres(session.genre_counts, distances)
+
+    changed = {genre: score for genre, score in new_scores.items() if old_scores.get(genre) != score}
+    removed = [genre for genre in old_scores if genre not in new_scores]
+
+    # Engines that are already built are patched; pending ones get built from the new state
+    heap, trie, bst = session.built_engines()
+    for genre in removed:
+        if heap is not None:
+            heap.remove(genre)
+        if trie is not None:
+            trie.delete(genre)
+    for genre, score in changed.items():
+        if heap is not None:
+            heap.update_score(genre, score)
+        if trie is not None and genre not in old_scores:
+            trie.insert(genre)
+    if bst is not None:
+        for artist in touched_artists:
+            bst.update_count(artist, old_artist_counts.get(artist, 0), session.artist_counts.get(artist, 0))
+
+    session.genre_scores = new_scores
+    session.distances = distances
+    session.fingerprint = None  # No cached response matches the session any more
+    session.last_updated = datetime.now().isoformat()
+
+    ranking = sorted(
+        ({'genre': genre, 'score': score,
+          'rank': 1 + sum(1 for other in new_scores.values() if other > score)}
+         for genre, score in changed.items()),
+        key=lambda item: item['rank']
+    )
+
+    return {
+        'applied': len(events) - len(skipped),
+        'skipped': skipped,
+        'changedScores': changed,
+        'removedGenres': removed,
+        'ranking': ranking,
+        'playlist_size': session.playlist_size,
+        'recommendations_size': session.recommendations_size
+    }
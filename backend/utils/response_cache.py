@@ -0,0 +1,98 @@
+"""
+Response Cache Utility
+Bounded LRU cache of serialized responses keyed by a canonical fingerprint of the request payload
+"""
+
+import json
+import time
+import hashlib
+import threading
+from collections import OrderedDict
+
+from utils import json_io
+
+def fingerprint(*parts):
+    """
+    Canonical SHA-256 of JSON-serializable parts
+    Key order and whitespace do not matter, so equal payloads always hash the same.
+    Every lookup (hits included) pays for this, so it uses the fast json_io serializer
+    """
+    try:
+        canonical = json_io.dumps(parts)
+    except (TypeError, ValueError):
+        # Values JSON cannot represent (only from internal callers) are keyed by their str()
+        canonical = json.dumps(parts, sort_keys=True, separators=(',', ':'), default=str).encode('utf-8')
+    return hashlib.sha256(canonical).hexdigest()
+
+
+class ResponseCache:
+    """
+    Maps fingerprint -> (expires_at, value)
+    Least recently used entries are evicted once capacity is reached; expired entries are
+    dropped lazily when they are looked up
+    """
+    def __init__(self, capacity=256, ttl=300, clock=time.monotonic):
+        self.capacity = capacity
+        self.ttl = ttl
+        self.clock = clock
+        self._entries = OrderedDict()
+        self._lock = threading.Lock()
+        self.hits = 0
+        self.misses = 0
+        self.evictions = 0
+
+    def get(self, key):
+        """Cached value for a key, or None if missing or expired"""
+        with self._lock:
+            entry = self._entries.get(key)
+            if entry is None:
+                self.misses += 1
+                return None
+
+            expires_at, value = entry
+            if expires_at is not None and expires_at <= self.clock():
+                del self._entries[key]
+                self.misses += 1
+                return None
+
+            self._entries.move_to_end(key)
+            self.hits += 1
+            return value
+
+    def put(self, key, value, ttl=None):
+        """Store a value; ttl (seconds) overrides the default, 0 or None-default means no expiry"""
+        ttl = self.ttl if ttl is None else ttl
+        expires_at = self.clock() + ttl if ttl else None
+
+        with self._lock:
+            self._entries[key] = (expires_at, value)
+            self._entries.move_to_end(key)
+            while len(self._entries) > self.capacity:
+                self._entries.popitem(last=False)
+                self.evictions += 1
+
+    def invalidate(self, key):
+        """Drop one entry"""
+        with self._lock:
+            return self._entries.pop(key, None) is not None
+
+    def clear(self):
+        """Drop every entry"""
+        with self._lock:
+            self._entries.clear()
+
+    def size(self):
+        """Number of stored entries (expired ones included until looked up)"""
+        return len(self._entries)
+
+    def get_statistics(self):
+        """Get statistics about the cache"""
+        lookups = self.hits + self.misses
+        return {
+            'entries': self.size(),
+            'capacity': self.capacity,
+            'hits': self.hits,
+            'misses': self.misses,
+            'evictions': self.evictions,
+            'hit_rate': round(self.hits / lookups, 3) if lookups else 0
+        }
@@ -0,0 +1,280 @@
+"""
+Session Manager Utility
+Per-user engine contexts (graph, heap, trie, BST) so concurrent users never share mutable state
+"""
+
+import threading
+from contextlib import contextmanager
+from collections import OrderedDict, Counter, defaultdict
+
+from data_structures.graph import MusicGraph
+from data_structures.heap import RecommendationHeap
+from data_structures.trie import GenreTrie
+from data_structures.bst import ArtistBST
+
+DEFAULT_SESSION = 'default'
+
+class EngineSession:
+    """
+    Engines and request data of one user/session
+    The graph, genre scores and counts are always published; the heap, trie and BST are
+    built from them on first use when the request that published them did not need them.
+    Published engines may be shared with the response cache and other sessions, so they are
+    never mutated: take_ownership() gives the session private copies before playlist events
+    change them in place (under the session lock)
+    """
+    def __init__(self, session_id):
+        self.session_id = session_id
+        self.lock = threading.Lock()  # Serializes writers of this session
+        self._build_lock = threading.Lock()  # Guards lazy engine builds
+        self.evicted = False  # Set under self.lock once the snapshot is taken; writes after it are lost
+
+        self.publish(MusicGraph(), {}, {})
+        self.distances = {}
+
+        self.playlist = []
+        self.recommendations = []
+        self.users = []
+        self.playlist_size = 0
+        self.recommendations_size = 0
+        self.last_updated = None
+
+    def publish(self, graph, genre_scores, artist_counts, fingerprint=None,
+                heap=None, trie=None, bst=None, genre_counts=None, song_genre_counts=None,
+                distances=None):
+        """Swap in freshly built engines (heap, trie and bst may be left to lazy builds)"""
+        with self._build_lock:
+            self.graph = graph
+            self.genre_scores = genre_scores
+            self.artist_counts = artist_counts
+            self.genre_counts = genre_counts if genre_counts is not None else Counter()
+            self.song_genre_counts = song_genre_counts if song_genre_counts is not None else Counter()
+            self.distances = distances or {}
+            self.fingerprint = fingerprint
+            self._heap, self._trie, self._bst = heap, trie, bst
+            self._owned = False
+    
+    def take_ownership(self):
+        """
+        Replace shared engines and counts with private copies that may be changed in place
+        Heap, trie and BST are dropped instead of copied; they are rebuilt lazily from the copies
+        """
+        with self._build_lock:
+            if self._owned:
+                return
+            self.graph = self.graph.copy()
+            self.genre_scores = dict(self.genre_scores)
+            self.artist_counts = dict(self.artist_counts)
+            self.genre_counts = Counter(self.genre_counts)
+            self.song_genre_counts = Counter(self.song_genre_counts)
+            self.distances = dict(self.distances)
+            self._heap, self._trie, self._bst = None, None, None
+            self._owned = True
+    
+    def built_engines(self):
+        """(heap, trie, bst) that are already built, None for the ones still pending"""
+        return self._heap, self._trie, self._bst
+
+    def state(self):
+        """Published engines as publish() keyword arguments"""
+        with self._build_lock:
+            return {
+                'graph': self.graph,
+                'genre_scores': self.genre_scores,
+                'artist_counts': self.artist_counts,
+                'genre_counts': self.genre_counts,
+                'song_genre_counts': self.song_genre_counts,
+                'distances': self.distances,
+                'heap': self._heap,
+                'trie': self._trie,
+                'bst': self._bst
+            }
+
+    @property
+    def heap(self):
+        """Max heap of genre scores (built on first use)"""
+        with self._build_lock:
+            if self._heap is None:
+                self._heap = RecommendationHeap()
+                for genre, score in self.genre_scores.items():
+                    self._heap.insert(genre, score)
+            return self._heap
+
+    @property
+    def trie(self):
+        """Genre trie (built on first use)"""
+        with self._build_lock:
+            if self._trie is None:
+                self._trie = GenreTrie()
+                for genre in self.genre_scores:
+                    self._trie.insert(genre)
+            return self._trie
+
+    @property
+    def bst(self):
+        """Artist BST (built on first use)"""
+        with self._build_lock:
+            if self._bst is None:
+                self._bst = ArtistBST()
+                for artist, count in self.artist_counts.items():
+                    self._bst.insert(artist, count)
+            return self._bst
+
+    def engines(self):
+        """Current (graph, heap, trie, bst), building any missing one"""
+        return self.graph, self.heap, self.trie, self.bst
+
+    def set_data(self, playlist, recommendations, users, last_updated):
+        """Store the request payload of the session"""
+        self.playlist = playlist
+        self.recommendations = recommendations
+        self.users = users
+        self.playlist_size = len(playlist)
+        self.recommendations_size = len(recommendations)
+        self.last_updated = last_updated
+
+    def snapshot(self):
+        """
+        Compact form kept after eviction: only what is needed to rebuild the engines
+        (the song lists are dropped, their sizes are kept for /api/stats)
+        """
+        return {
+            'genre_scores': dict(self.genre_scores),
+            'artist_counts': dict(self.artist_counts),
+            'weighted_genre_counts': dict(self.genre_counts),
+            'song_genre_counts': dict(self.song_genre_counts),
+            'distances': dict(self.distances),
+            'genre_counts': dict(self.graph.genre_counts),
+            'adjacency': {node: [dict(edge) for edge in edges]
+                          for node, edges in self.graph.get_adjacency_list().items()},
+            'playlist_size': self.playlist_size,
+            'recommendations_size': self.recommendations_size,
+            'last_updated': self.last_updated,
+            'fingerprint': self.fingerprint
+        }
+
+    @classmethod
+    def from_snapshot(cls, session_id, snapshot):
+        """
+        Rebuild a session from snapshot() output
+        Heap, trie and BST are rebuilt lazily in the original insertion order, so they come back identical
+        """
+        session = cls(session_id)
+
+        graph = MusicGraph()
+        graph.genre_counts = Counter(snapshot['genre_counts'])
+        graph.adjacency_list = defaultdict(list, snapshot['adjacency'])
+        graph.nodes = set(snapshot['adjacency'])
+
+        session.publish(graph, snapshot['genre_scores'], snapshot['artist_counts'], snapshot['fingerprint'],
+                        genre_counts=Counter(snapshot['weighted_genre_counts']),
+                        song_genre_counts=Counter(snapshot['song_genre_counts']),
+                        distances=snapshot['distances'])
+        session.playlist_size = snapshot['playlist_size']
+        session.recommendations_size = snapshot['recommendations_size']
+        session.last_updated = snapshot['last_updated']
+        return session
+
+
+class SessionManager:
+    """
+    LRU of resident sessions; the least recently used one is evicted to a compact snapshot
+    once more than max_resident sessions are live, and restored on its next request.
+    Lock order is session.lock, then the manager lock: snapshots are taken outside the manager
+    lock, so a slow request on one session never blocks lookups of the others
+    """
+    def __init__(self, max_resident=64, max_snapshots=10000):
+        self.max_resident = max_resident
+        self.max_snapshots = max_snapshots
+        self._resident = OrderedDict()  # session id -> EngineSession
+        self._snapshots = OrderedDict()  # session id -> snapshot dict
+        self._evicting = {}  # session id -> EngineSession popped from _resident, not yet snapshotted
+        self._lock = threading.Lock()
+        self.evictions = 0
+        self.restores = 0
+
+    def get(self, session_id):
+        """Resident session for an id, restoring or creating it when needed"""
+        session_id = session_id or DEFAULT_SESSION
+
+        with self._lock:
+            session = self._resident.get(session_id)
+            if session is not None:
+                self._resident.move_to_end(session_id)
+                return session
+
+            # Requested again before its eviction finished: keep the live session instead
+            session = self._evicting.pop(session_id, None)
+            if session is None:
+                snapshot = self._snapshots.pop(session_id, None)
+                if snapshot is not None:
+                    session = EngineSession.from_snapshot(session_id, snapshot)
+                    self.restores += 1
+                else:
+                    session = EngineSession(session_id)
+
+            self._resident[session_id] = session
+            victims = []
+            while len(self._resident) > self.max_resident:
+                victim_id, victim = self._resident.popitem(last=False)
+                self._evicting[victim_id] = victim
+                victims.append((victim_id, victim))
+
+        for victim_id, victim in victims:
+            self._evict(victim_id, victim)
+        return session
+
+    @contextmanager
+    def locked(self, session_id):
+        """
+        Resident session for an id with its lock held (for writers)
+        A session evicted while the caller waited for its lock is re-fetched, so writes are
+        never made to a session whose snapshot was already taken
+        """
+        while True:
+            session = self.get(session_id)
+            session.lock.acquire()
+            if not session.evicted:
+                break
+            session.lock.release()
+        try:
+            yield session
+        finally:
+            session.lock.release()
+
+    def peek(self, session_id):
+        """Resident session for an id without creating one (None if not resident)"""
+        with self._lock:
+            return self._resident.get(session_id or DEFAULT_SESSION)
+
+    def _evict(self, session_id, session):
+        """Snapshot a session popped from the resident LRU (manager lock not held)"""
+        with session.lock:  # Let an in-flight request on it finish first
+            snapshot = session.snapshot()
+            with self._lock:
+                if self._evicting.get(session_id) is not session:
+                    return  # Requested again meanwhile, it stays resident
+                del self._evicting[session_id]
+                session.evicted = True
+                self._snapshots[session_id] = snapshot
+                self.evictions += 1
+
+                while len(self._snapshots) > self.max_snapshots:
+                    self._snapshots.popitem(last=False)
+
+    def drop(self, session_id):
+        """Forget a session entirely"""
+        with self._lock:
+            removed = self._resident.pop(session_id, None) is not None
+            removed = (self._evicting.pop(session_id, None) is not None) or removed
+            return (self._snapshots.pop(session_id, None) is not None) or removed
+
+    def get_statistics(self):
+        """Get statistics about resident and evicted sessions"""
+        return {
+            'resident': len(self._resident),
+            'snapshots': len(self._snapshots),
+            'max_resident': self.max_resident,
+            'evictions': self.evictions,
+            'restores': self.restores
+        }
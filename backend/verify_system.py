@@ -6,6 +6,9 @@ Run this from the backend folder: python verify_system.py
 
 import sys
 import json
+import math
+import time
+import random
 
 def test_graph():
     """Test Graph implementation"""
@@ -141,6 +144,99 @@ def test_bst():
     print("\n✅ BST TEST PASSED!")
     return True
 
+def test_feature_store():
+    """Test Song Feature Store implementation"""
+    print("\n" + "="*60)
+    print("TESTING SONG FEATURE STORE")
+    print("="*60)
+    
+    from data_structures.feature_store import SongFeatureStore
+    
+    store = SongFeatureStore()
+    
+    songs = [
+        {'id': 1, 'genre': 'Rock', 'artist': 'Queen', 'price': 1.29, 'duration': 354000},
+        {'id': 2, 'genre': 'Rock', 'artist': 'Queen', 'price': 0.99, 'duration': 215000},
+        {'id': 3, 'genre': 'Jazz', 'artist': 'Miles Davis', 'price': 1.99, 'duration': 545000},
+    ]
+    
+    first = store.vectors_for(songs)
+    second = store.vectors_for(songs)  # Second pass is served from the cache
+    assert [list(v) for v in first] == [list(v) for v in second] == [store._compute(song) for song in songs]
+    assert len(first[0]) == store.dimension and all(0 <= x <= 1 for v in first for x in v)
+    stats = store.get_statistics()
+    assert stats['songs'] == 3 and stats['misses'] == 3 and stats['hits'] == 3
+    
+    # A reused id with different fields must not get the stale vector
+    changed = dict(songs[0], genre='Jazz', price=0.49)
+    assert list(store.vector(changed)) == store._compute(changed) != store._compute(songs[0])
+    
+    # SongTable rows get the same vectors (and cache entries) as the song dicts
+    from data_structures.song_table import SongTable
+    table = SongTable.from_payload(songs, [])
+    assert [list(v) for v in store.vectors_for_table(table)] == [list(v) for v in first]
+    
+    store.clear()
+    assert store.size() == 0 and store.get_statistics()['bytes'] == 0
+    assert list(store.vector(songs[2])) == list(first[2]), "Vectors must be rebuilt after clear()"
+    
+    small = SongFeatureStore(capacity=2)
+    small.vectors_for(songs)  # The third song overflows and resets the store
+    assert small.size() == 1 and list(small.vector(songs[0])) == list(first[0])
+    
+    print(f"✓ Vector dimension: {store.dimension}")
+    print(f"✓ Cache stats: {stats}")
+    
+    nearest = store.nearest(songs[0], songs, top_k=1)
+    assert nearest[0][1]['id'] == 2, "Same genre and artist should be nearest"
+    assert abs(nearest[0][0] - math.dist(first[0], first[1])) < 1e-12
+    print(f"✓ Nearest to song 1: song {nearest[0][1]['id']} (distance {nearest[0][0]:.3f})")
+    
+    print("\n✅ FEATURE STORE TEST PASSED!")
+    return True
+
+def test_playlist_lsh():
+    """Test MinHash/LSH playlist index"""
+    print("\n" + "="*60)
+    print("TESTING MINHASH LSH INDEX")
+    print("="*60)
+    
+    from data_structures.playlist_lsh import PlaylistLSHIndex
+    
+    index = PlaylistLSHIndex()
+    
+    songs = [{'id': i, 'genre': f'Genre{i % 4}', 'artist': f'Artist{i}'} for i in range(20)]
+    index.add('alice', songs[:10])
+    index.add('bob', songs[:9])
+    index.add('carol', songs[10:])
+    
+    matches = index.query_user('alice', top_k=2)
+    assert index.size() == 3
+    assert matches == [{'user_id': 'bob', 'similarity': round(22 / 24, 4)}], "bob is alice's only candidate"
+    assert 'carol' not in [m['user_id'] for m in index.query(songs[:10])], "Jaccard 4/44 is below the LSH threshold"
+    
+    # Signature agreement estimates Jaccard similarity
+    def estimate(user1, user2):
+        pairs = zip(index.signatures[user1], index.signatures[user2])
+        return sum(a == b for a, b in pairs) / index.num_perm
+    
+    def exact(user1, user2):
+        tokens1, tokens2 = index.token_sets[user1], index.token_sets[user2]
+        return len(tokens1 & tokens2) / len(tokens1 | tokens2)
+    
+    for pair in (('alice', 'bob'), ('alice', 'carol'), ('bob', 'carol')):
+        assert abs(estimate(*pair) - exact(*pair)) <= 0.1, f"MinHash estimate off for {pair}"
+    
+    index.add('bob', songs[10:19])  # Re-indexing replaces the old playlist
+    assert index.size() == 3 and [m['user_id'] for m in index.query_user('carol')] == ['bob']
+    assert index.query_user('alice') == []
+    assert index.remove('bob') and not index.remove('bob') and index.query_user('carol') == []
+    print("✓ Indexed playlists: 3")
+    print(f"✓ Most similar to alice: {matches[0]['user_id']} ({matches[0]['similarity']})")
+    
+    print("\n✅ MINHASH LSH TEST PASSED!")
+    return True
+
 def test_dijkstra():
     """Test Dijkstra's Algorithm"""
     print("\n" + "="*60)
@@ -216,6 +312,77 @@ def test_sorting():
     print(f"  Comparisons: {ms.comparison_count}")
     print(f"  Time: {ms.execution_time:.6f}s")
     
+    assert sorted_qs == ['Jazz', 'Rock', 'Electronic', 'Pop', 'Classical']
+    assert sorted_ms == ['Rock', 'Jazz', 'Pop', 'Classical']
+    
+    from algorithms.sorting import top_k_sorted
+    from algorithms.radix_sort import RADIX_MIN_SIZE
+    
+    def ranked(scores, order, descending):
+        """Orders must be a permutation of the keys with scores in sorted() order"""
+        assert sorted(order) == sorted(scores)
+        assert [scores[name] for name in order] == sorted(scores.values(), reverse=descending)
+    
+    random.seed(7)
+    n = 2 * RADIX_MIN_SIZE
+    inputs = {
+        'random': {f'g{i}': random.random() for i in range(n)},
+        'ties': {f'g{i}': random.randint(0, 9) for i in range(n)},
+        'all equal': {f'g{i}': 3.0 for i in range(n)},
+        'ascending': {f'g{i}': i for i in range(n)},
+        'descending': {f'g{i}': n - i for i in range(n)},
+        'small ties': {'a': 2, 'b': 1, 'c': 2, 'd': 2, 'e': 0},
+    }
+    for label, scores in inputs.items():
+        for allow_radix in (False, True):
+            qs = QuickSort()
+            ranked(scores, qs.sort_by_score(scores, allow_radix=allow_radix), descending=True)
+            assert allow_radix or qs.engine == 'introsort'
+            ms = MergeSort()
+            ranked(scores, ms.sort_by_distance(scores, allow_radix=allow_radix), descending=False)
+            ranked(scores, ms.sort_by_count(scores, allow_radix=allow_radix), descending=True)
+        for k in (0, 1, 5, len(scores), len(scores) + 3):
+            top = top_k_sorted(scores, k)
+            assert len(top) == min(k, len(scores)), f"top_k_sorted size ({label}, k={k})"
+            assert [scores[name] for name in top] == sorted(scores.values(), reverse=True)[:k]
+    
+    ms = MergeSort()
+    ranked(inputs['random'], ms.sort_by_distance(inputs['random']), descending=False)
+    assert ms.engine == 'radix', "Large numeric input should take the radix path"
+    
+    # Keys radix sort cannot order exactly fall back to comparisons; exact ones stay on radix
+    big = 2 ** 53
+    edge_cases = {
+        'huge int': ({f'g{i}': i for i in range(n - 1)} | {'huge': 10 ** 400}, 'mergesort'),
+        'beyond float precision': ({f'g{i}': big + (i % 3) - 1 for i in range(n)}, 'radix'),
+        'int64 limits': ({f'g{i}': (-1) ** i * (2 ** 63 - 1 - i) for i in range(n)}, 'radix'),
+        'mixed inexact': ({f'g{i}': i + 0.5 for i in range(n - 1)} | {'odd': big + 1}, 'mergesort'),
+        'mixed exact': ({f'g{i}': i if i % 2 else i + 0.5 for i in range(n)}, 'radix'),
+        'bool': ({f'g{i}': i % 2 == 0 for i in range(n)}, 'mergesort'),
+        'signed zero': ({f'g{i}': (0.0, -0.0, 1.5, -1.5)[i % 4] for i in range(n)}, 'radix'),
+    }
+    for label, (scores, engine) in edge_cases.items():
+        ms = MergeSort()
+        order = ms.sort_by_distance(scores)
+        assert ms.engine == engine, f"{label}: expected the {engine} engine"
+        assert order == MergeSort().sort_by_distance(scores, allow_radix=False), f"{label}: order differs"
+        order = ms.sort_by_count(scores)
+        assert order == MergeSort().sort_by_count(scores, allow_radix=False), f"{label}: order differs"
+        ranked(scores, QuickSort().sort_by_score(scores), descending=True)
+    print(f"✓ Radix falls back exactly on {len(edge_cases)} edge-case key sets")
+    print(f"\n✓ Introsort, radix, merge sort and top-k agree with sorted() on {len(inputs)} inputs")
+    
+    # Parallel merge sort: above PARALLEL_MIN_SIZE and stable (ties keep input order)
+    n = MergeSort.PARALLEL_MIN_SIZE + 1000
+    scores = {f'g{i}': random.randint(0, 50) for i in range(n)}
+    expected = [name for name, _ in sorted(scores.items(), key=lambda item: item[1])]
+    assert MergeSort().sort_by_distance(scores, allow_radix=False) == expected
+    expected = [name for name, _ in sorted(scores.items(), key=lambda item: item[1], reverse=True)]
+    assert MergeSort().sort_by_count(scores, allow_radix=False) == expected
+    reverse = {f'g{i}': n - i for i in range(n)}
+    assert MergeSort().sort_by_distance(reverse, allow_radix=False) == sorted(reverse, key=reverse.get)
+    print(f"✓ Parallel merge sort is stable on {n} items")
+    
     print("\n✅ SORTING TEST PASSED!")
     return True
 
@@ -244,6 +411,61 @@ def test_clustering():
     print(f"✓ Silhouette score: {result['silhouette_score']}")
     print(f"\n✓ Cluster sizes: {result['cluster_sizes']}")
     
+    # Silhouette: the exact path equals a brute-force score, the sampled one stays close to it
+    def brute_force_silhouette(features, labels):
+        values = []
+        for i, point in enumerate(features):
+            own = [j for j, label in enumerate(labels) if label == labels[i]]
+            if len(own) == 1:
+                values.append(0.0)
+                continue
+            a = sum(math.dist(point, features[j]) for j in own) / (len(own) - 1)
+            b = min(sum(math.dist(point, features[j]) for j, label in enumerate(labels) if label == other) /
+                    labels.count(other) for other in set(labels) if other != labels[i])
+            values.append((b - a) / max(a, b) if max(a, b) > 0 else 0.0)
+        return sum(values) / len(values)
+    
+    rng = random.Random(11)
+    features = [[rng.gauss(i % 3, 0.8) for _ in range(8)] for i in range(900)]
+    labels = [i % 3 if rng.random() < 0.9 else 3 for i in range(900)]  # Plus a small noisy cluster
+    
+    small = clusterer._calculate_silhouette_score(features[:150], labels[:150])
+    assert small['method'] == 'exact' and small['confidence'] == 0.0
+    assert small['score'] == round(brute_force_silhouette(features[:150], labels[:150]), 3)
+    
+    exact = clusterer._calculate_silhouette_score(features, labels, exact_limit=len(features))
+    sampled = clusterer._calculate_silhouette_score(features, labels)
+    assert exact['method'] == 'exact' and sampled['method'] == 'sampled'
+    assert abs(sampled['score'] - exact['score']) <= 0.05, "Sampled silhouette must stay within 0.05"
+    print(f"✓ Silhouette exact {exact['score']}, sampled {sampled['score']} ± {sampled['confidence']}")
+    
+    # Mini-batch streaming test
+    from algorithms.clustering import MiniBatchMusicClusterer
+    
+    from data_structures.feature_store import default_feature_store
+    
+    stream_clusterer = MiniBatchMusicClusterer(k=2, batch_size=2)
+    cached = default_feature_store.size()
+    summary = stream_clusterer.fit_stream(iter(songs))
+    assert default_feature_store.size() == cached, "Streaming must not fill the shared feature cache"
+    assert summary['total_clusters'] == 2, "Mini-batch should seed k centroids"
+    assert summary['songs_seen'] == len(songs), "Every streamed song must be counted"
+    assert sum(summary['cluster_sizes'].values()) == summary['songs_seen'], "Cluster sizes must add up to songs seen"
+    
+    # partial_fit moves the nearest centroid towards the new point
+    new_song = {'genre': 'Rock', 'artist': 'Artist6', 'price': 0.99}
+    point = stream_clusterer._extract_features([new_song])[0]
+    nearest = stream_clusterer._find_nearest_centroid(point, stream_clusterer.centroids)
+    before = stream_clusterer._squared_distance(point, stream_clusterer.centroids[nearest])
+    stream_clusterer.partial_fit([new_song])
+    after = stream_clusterer._squared_distance(point, stream_clusterer.centroids[nearest])
+    assert stream_clusterer.songs_seen == len(songs) + 1
+    assert before == 0 or after < before, "partial_fit must move the centroid towards the new point"
+    assert sum(stream_clusterer.get_stream_summary()['cluster_sizes'].values()) == stream_clusterer.songs_seen
+    print(f"\n✓ Mini-batch clusters: {summary['total_clusters']}")
+    print(f"✓ Songs streamed: {stream_clusterer.songs_seen}")
+    print(f"✓ Centroid moved: {before:.4f} -> {after:.4f}")
+    
     print("\n✅ CLUSTERING TEST PASSED!")
     return True
 
@@ -283,6 +505,10 @@ def test_analyzer():
     print(f"\n✓ Genre diversity: {patterns['genre_diversity']}")
     print(f"✓ Artist diversity: {patterns['artist_diversity']}")
     
+    # Test similar songs (posting-list lookup)
+    similar = analyzer.find_similar_songs(playlist[0], playlist + recommendations)
+    print(f"\n✓ Songs similar to first playlist song: {len(similar)}")
+    
     # Test insights
     insights = analyzer.generate_insights(playlist, recommendations)
     print(f"\n✓ Generated {len(insights)} insights")
@@ -292,6 +518,665 @@ def test_analyzer():
     print("\n✅ ANALYZER TEST PASSED!")
     return True
 
+def test_json_io():
+    """Test the streaming JSON writer against the standard json module"""
+    print("\n" + "="*60)
+    print("TESTING JSON STREAMING WRITER")
+    print("="*60)
+    
+    from utils import json_io
+    
+    songs = [{'id': i, 'title': f'Canción {i}', 'artist': ['Björk', 'Sigur Rós', '坂本龍一'][i % 3],
+              'features': {'energy': i / 100, 'tags': ['é', '✓', None, True]}} for i in range(100)]
+    documents = [
+        {'title': 'Für Elise', 'nested': {'b': {'c': [1, 2.5, 'ß']}, 'a': {}}},
+        songs,
+        {f'key{i}': {'n': i, 'name': 'Ærø', 'inner': {'z': [i], 'y': 'ü'}} for i in range(80)},
+        {'results': songs, 'count': len(songs), 'emoji': '🎵'},
+        [[], {}, '', 0, -1.5, False, None, 'naïve'],
+    ]
+    
+    def check():
+        for document in documents:
+            expected = json.loads(json.dumps(document))
+            streamed = b''.join(json_io.iter_dumps(document))
+            assert json.loads(streamed.decode('utf-8')) == expected, "Streamed output must parse back equal"
+            assert streamed == json_io.dumps(document), "Streaming must not change the bytes"
+        assert len(list(json_io.iter_dumps(songs))) > len(songs), "Large lists must be streamed item by item"
+        
+        # Lazy values: generators stream as arrays, StreamObject members keep their order
+        lazy = json_io.StreamObject([('songs', (song for song in songs)), ('total', len(songs)),
+                                     ('meta', {'genre': 'Música', 'pages': iter([1, 2])})])
+        streamed = b''.join(json_io.iter_dumps(lazy))
+        assert streamed.startswith(b'{"songs":[')
+        assert json.loads(streamed.decode('utf-8')) == {'songs': json.loads(json.dumps(songs)), 'total': 100,
+                                                         'meta': {'genre': 'Música', 'pages': [1, 2]}}
+    
+    check()
+    print(f"✓ {json_io.BACKEND}: streamed output matches the json module")
+    
+    # Same checks on the standard library fallback
+    native = json_io.orjson
+    json_io.orjson = None
+    try:
+        check()
+    finally:
+        json_io.orjson = native
+    print("✓ json fallback: streamed output matches the json module")
+    
+    print("\n✅ JSON STREAMING WRITER TEST PASSED!")
+    return True
+
+def test_response_cache():
+    """Test request-fingerprint response cache"""
+    print("\n" + "="*60)
+    print("TESTING RESPONSE CACHE")
+    print("="*60)
+    
+    from utils.response_cache import ResponseCache, fingerprint
+    
+    now = [0]
+    cache = ResponseCache(capacity=2, ttl=10, clock=lambda: now[0])
+    
+    key = fingerprint([{'genre': 'Pop', 'id': 1}])
+    assert key == fingerprint([{'id': 1, 'genre': 'Pop'}]), "Key order must not change the fingerprint"
+    assert key != fingerprint([{'genre': 'Pop', 'id': 2}])
+    assert fingerprint({'title': 'Für Elise'}, 5) == fingerprint({'title': 'Für Elise'}, 5)
+    assert len(fingerprint(object())) == 64, "Values JSON cannot represent still get a key"
+    
+    cache.put(key, b'{}')
+    cache.put('b', b'1')
+    cache.put('c', b'2')
+    assert cache.get(key) is None, "Oldest entry should be evicted at capacity"
+    assert cache.get('b') == b'1' and cache.get('c') == b'2'
+    
+    # 'b' was read before 'c', so 'b' is now the least recently used entry
+    cache.put('d', b'3', ttl=0)
+    assert cache.get('b') is None, "Least recently used entry should be evicted"
+    assert cache.get('c') == b'2'
+    print("✓ LRU eviction")
+    
+    now[0] = 11
+    assert cache.get('c') is None, "Entry should expire after its ttl"
+    assert cache.get('d') == b'3', "ttl=0 entries never expire"
+    stats = cache.get_statistics()
+    assert stats['evictions'] == 2 and stats['hits'] == 4 and stats['misses'] == 3
+    print("✓ TTL expiry")
+    print(f"✓ Stats: {stats}")
+    
+    # End to end: miss, hit for the same payload (any key order), miss again once expired
+    import songs_recommendations as server
+    
+    client = server.app.test_client()
+    clock = [0]
+    server.response_cache.clock = lambda: clock[0]
+    try:
+        playlist = [{'id': 1, 'title': 'Song 1', 'artist': 'Queen', 'genre': 'Rock'},
+                    {'id': 2, 'title': 'Song 2', 'artist': 'Björk', 'genre': 'Pop'}]
+        reordered = [{'genre': song['genre'], 'artist': song['artist'], 'title': song['title'], 'id': song['id']}
+                     for song in playlist]
+        first = client.post('/api/recommend', json={'playlist': playlist, 'recommendations': []})
+        second = client.post('/api/recommend', json={'playlist': reordered, 'recommendations': []})
+        assert first.headers['X-Cache'] == 'MISS' and second.headers['X-Cache'] == 'HIT'
+        assert first.data == second.data, "A hit must return the cached body"
+        clock[0] = server.response_cache.ttl + 1
+        third = client.post('/api/recommend', json={'playlist': playlist, 'recommendations': []})
+        assert third.headers['X-Cache'] == 'MISS', "Expired entries must be recomputed"
+    finally:
+        server.response_cache.clock = time.monotonic
+    print("✓ /api/recommend: MISS, HIT, MISS after expiry")
+    
+    print("\n✅ RESPONSE CACHE TEST PASSED!")
+    return True
+
+def test_sessions():
+    """Test per-session engines, eviction to snapshots and restore"""
+    print("\n" + "="*60)
+    print("TESTING SESSION MANAGER")
+    print("="*60)
+    
+    from data_structures.graph import MusicGraph
+    from utils.sessions import SessionManager
+    
+    sessions = SessionManager(max_resident=1)
+    
+    songs = [{'genre': 'Rock'}, {'genre': 'Rock'}, {'genre': 'Jazz'}]
+    graph = MusicGraph()
+    graph.build_genre_graph(songs, [])
+    alice = sessions.get('alice')
+    alice.publish(graph, {'Rock': 2.0, 'Jazz': 1.0}, {'Queen': 2, 'Miles Davis': 1})
+    assert alice.trie.search_prefix('ro') == [{'word': 'rock', 'frequency': 1}]
+    assert sessions.get('alice') is alice, "A resident session must be reused"
+    
+    bob = sessions.get('bob')  # Evicts alice to a snapshot
+    assert alice.evicted and not bob.evicted
+    assert bob.genre_scores == {}, "Sessions must not share state"
+    stats = sessions.get_statistics()
+    assert stats['resident'] == 1 and stats['snapshots'] == 1 and stats['evictions'] == 1
+    
+    with sessions.locked('alice') as restored:
+        assert restored is not alice and not restored.evicted, "Writers must get the live session"
+        assert restored.genre_scores == alice.genre_scores
+        assert restored.artist_counts == alice.artist_counts
+        assert restored.graph.get_adjacency_list() == graph.get_adjacency_list()
+        assert restored.bst.search('Queen') == alice.bst.search('Queen')
+    assert sessions.get_statistics()['restores'] == 1
+    assert sessions.drop('bob') and sessions.peek('bob') is None
+    print(f"✓ Evicted and restored: {sessions.get_statistics()}")
+    
+    print("\n✅ SESSION MANAGER TEST PASSED!")
+    return True
+
+def test_response_fields():
+    """Test ?fields= selection on /api/recommend"""
+    print("\n" + "="*60)
+    print("TESTING RESPONSE FIELD SELECTION")
+    print("="*60)
+    
+    import songs_recommendations as server
+    
+    client = server.app.test_client()
+    playlist = [{'id': i, 'title': f'Song {i}', 'artist': f'Artist{i % 3}',
+                 'genre': ['Rock', 'Pop', 'Jazz'][i % 3]} for i in range(9)]
+    
+    full = client.post('/api/recommend', json={'playlist': playlist, 'recommendations': []}).get_json()
+    assert set(server.FIELD_STAGES) <= set(full), "Without fields every field is returned"
+    
+    response = client.post('/api/recommend?fields=genreCounts,orderedGenres',
+                           json={'playlist': playlist, 'recommendations': []})
+    body = response.get_json()
+    assert response.status_code == 200
+    assert set(body) == {'success', 'timestamp', 'genreCounts', 'orderedGenres'}
+    assert body['genreCounts'] == full['genreCounts']
+    
+    body = client.post('/api/recommend', json={'playlist': playlist, 'recommendations': [],
+                                               'include': ['distances']}).get_json()
+    assert set(body) == {'success', 'timestamp', 'distances'}
+    
+    response = client.post('/api/recommend', json={'playlist': playlist, 'fields': ['bogus']})
+    assert response.status_code == 400, "Unknown fields must be rejected"
+    assert server.parse_fields('insights, genreCounts') == ['genreCounts', 'insights']
+    print(f"✓ Selected fields: {sorted(body)}")
+    
+    print("\n✅ RESPONSE FIELD SELECTION TEST PASSED!")
+    return True
+
+def test_metrics():
+    """Test latency histograms and the Prometheus export"""
+    print("\n" + "="*60)
+    print("TESTING METRICS")
+    print("="*60)
+    
+    import threading
+    from utils.metrics import LatencyHistogram, MetricsRegistry
+    
+    histogram = LatencyHistogram()
+    for micros in range(1, 10001):
+        histogram.record(micros / 1000000)
+    
+    quantiles = histogram.percentiles([0.5, 0.99, 1.0])
+    for fraction, exact in ((0.5, 5000), (0.99, 9900), (1.0, 10000)):
+        assert abs(quantiles[fraction] * 1000000 - exact) <= exact / 64, f"p{fraction} is off"
+    
+    # Shards of finished threads are folded in, so they do not pile up
+    def record():
+        for _ in range(100):
+            histogram.record(0.002)
+    for _ in range(20):
+        thread = threading.Thread(target=record)
+        thread.start()
+        thread.join()
+    assert len(histogram._shards) == 21, "Registering a thread must not prune (no lock on the hot path)"
+    _, count, total, maximum = histogram.snapshot()
+    assert count == 10000 + 2000 and maximum == 10000
+    assert len(histogram._shards) <= 1, "Finished threads' shards must be merged"
+    
+    # Without reads, the shard count stays bounded by PRUNE_THRESHOLD
+    for _ in range(LatencyHistogram.PRUNE_THRESHOLD + 50):
+        thread = threading.Thread(target=histogram.record, args=(0.001,))
+        thread.start()
+        thread.join()
+    assert len(histogram._shards) <= LatencyHistogram.PRUNE_THRESHOLD + 1
+    assert histogram.snapshot()[1] == 12000 + LatencyHistogram.PRUNE_THRESHOLD + 50
+    
+    registry = MetricsRegistry(prefix='verify')
+    with registry.span('stage'):
+        pass
+    registry.gauge('answer', "A constant", lambda: 42)
+    text = registry.to_prometheus()
+    assert 'verify_stage_duration_seconds_count{stage="stage"} 1' in text
+    assert 'verify_answer 42' in text
+    assert registry.summary('stage')['count'] == 1
+    print(f"✓ p50/p99: {quantiles[0.5] * 1000:.3f} ms / {quantiles[0.99] * 1000:.3f} ms")
+    
+    print("\n✅ METRICS TEST PASSED!")
+    return True
+
+def test_stage_pipeline():
+    """Test the stage DAG runner"""
+    print("\n" + "="*60)
+    print("TESTING STAGE PIPELINE")
+    print("="*60)
+    
+    import threading
+    from utils.pipeline import StagePipeline, create_stage_executor
+    
+    barrier = threading.Barrier(2, timeout=5)
+    
+    def build(concurrent):
+        def side(name):
+            def run(results):
+                if concurrent:
+                    barrier.wait()  # Only passes if both sides run at the same time
+                return results['source'] + [name]
+            return run
+        
+        pipeline = StagePipeline()
+        pipeline.add('source', lambda results: ['source'])
+        pipeline.add('left', side('left'), deps=['source'])
+        pipeline.add('right', side('right'), deps=['source'])
+        pipeline.add('join', lambda results: sorted(results['left'] + results['right']),
+                     deps=['left', 'right'])
+        return pipeline
+    
+    serial = build(concurrent=False).run()
+    executor = create_stage_executor(max_workers=2, name='verify')
+    try:
+        parallel = build(concurrent=True).run(executor)
+    finally:
+        executor.shutdown()
+    assert serial == parallel, "Serial and concurrent runs must agree"
+    assert parallel['join'] == ['left', 'right', 'source', 'source']
+    
+    for add in (lambda p: p.add('x', lambda r: 1, deps=['missing']),
+                lambda p: p.add('source', lambda r: 1)):
+        try:
+            add(build(concurrent=False))
+            assert False, "Bad stage definitions must be rejected"
+        except ValueError:
+            pass
+    
+    failing = StagePipeline().add('boom', lambda results: 1 / 0)
+    try:
+        failing.run()
+        assert False, "A failing stage must raise"
+    except ZeroDivisionError:
+        pass
+    print(f"✓ Stages: {list(parallel)}")
+    
+    print("\n✅ STAGE PIPELINE TEST PASSED!")
+    return True
+
+def test_playlist_events():
+    """Test incremental playlist events against a full recompute"""
+    print("\n" + "="*60)
+    print("TESTING PLAYLIST EVENTS")
+    print("="*60)
+    
+    import songs_recommendations as server
+    from algorithms.dijkstra import DijkstraAlgorithm
+    from utils.analyzer import MusicAnalyzer
+    
+    client = server.app.test_client()
+    genres = ['Rock', 'Pop', 'Jazz', 'Blues']
+    
+    def song(i, genre=None):
+        return {'id': i, 'title': f'Song {i}', 'artist': f'Artist{i % 4}',
+                'genre': genre or genres[i % len(genres)]}
+    
+    playlist = [song(i) for i in range(12)]
+    recommendations = [song(i) for i in range(100, 106)]
+    headers = {'X-Session-Id': 'verify-events'}
+    client.post('/api/recommend', json={'playlist': playlist, 'recommendations': recommendations},
+                headers=headers)
+    session = server.sessions.get('verify-events')
+    session.heap, session.trie, session.bst  # Built engines are patched in place
+    
+    events = [
+        {'type': 'song_added', 'song': song(50, 'Reggae')},
+        {'type': 'song_removed', 'song': {'id': 3}},
+        {'type': 'recommendation_accepted', 'song': {'id': 101}},
+        {'type': 'recommendation_accepted', 'song': {'id': 999, 'genre': 'Rock'}},  # Never recommended
+        {'type': 'song_removed', 'song': {'id': 998}},  # Not in the playlist
+        {'type': 'song_removed', 'song': {'id': 2}},
+    ]
+    delta = client.post('/api/events', json={'events': events}, headers=headers).get_json()
+    assert delta['success'] and delta['applied'] == 4 and delta['skipped'] == [3, 4]
+    assert session.playlist_size == 12 and session.recommendations_size == 5
+    assert 'Reggae' in delta['changedScores'], "A new genre must be reported as changed"
+    assert [item['rank'] for item in delta['ranking']] == sorted(item['rank'] for item in delta['ranking'])
+    
+    # The same songs through the full pipeline must give the same state
+    client.post('/api/recommend', json={'playlist': list(session.playlist),
+                                        'recommendations': list(session.recommendations)},
+                headers={'X-Session-Id': 'verify-events-full'})
+    full = server.sessions.get('verify-events-full')
+    
+    def edges(graph):
+        return {(node, edge['to']): edge['weight'] for node, edge_list in graph.adjacency_list.items()
+                for edge in edge_list}
+    
+    assert dict(+session.genre_counts) == dict(+full.genre_counts)
+    assert session.artist_counts == full.artist_counts
+    assert session.graph.nodes == full.graph.nodes and edges(session.graph) == edges(full.graph)
+    source = sorted(session.graph.nodes)[0]  # Dijkstra's default source is arbitrary
+    assert (MusicAnalyzer.score_genres(session.genre_counts, DijkstraAlgorithm(session.graph)._dijkstra(source)) ==
+            MusicAnalyzer.score_genres(full.genre_counts, DijkstraAlgorithm(full.graph)._dijkstra(source)))
+    assert {item['genre']: item['score'] for item in session.heap.get_all_sorted()} == session.genre_scores
+    words = lambda trie: sorted(item['word'] for item in trie.get_all_words())
+    assert words(session.trie) == words(full.trie)
+    by_artist = lambda item: item['artist']
+    assert (sorted(session.bst.range_query(0, 10 ** 9), key=by_artist) ==
+            sorted(full.bst.range_query(0, 10 ** 9), key=by_artist))
+    
+    response = client.post('/api/events', json={'events': [{'type': 'bogus'}]}, headers=headers)
+    assert response.status_code == 400, "Malformed batches must be rejected"
+    print(f"✓ Applied {delta['applied']}, skipped {delta['skipped']}, matches a full recompute")
+    
+    print("\n✅ PLAYLIST EVENTS TEST PASSED!")
+    return True
+
+def test_graph_export():
+    """Test paginated JSON and binary graph export"""
+    print("\n" + "="*60)
+    print("TESTING GRAPH EXPORT")
+    print("="*60)
+    
+    from data_structures.graph import MusicGraph
+    from utils.graph_export import GraphExport, decode_binary
+    
+    graph = MusicGraph()
+    songs = [{'genre': genre} for genre, count in
+             (('Rock', 5), ('Pop', 3), ('Jazz', 1), ('Blues', 2), ('Metal', 4)) for _ in range(count)]
+    graph.build_genre_graph(songs, [])
+    expected = {(node, edge['to']): edge['weight'] for node, edges in graph.adjacency_list.items()
+                for edge in edges}
+    
+    # Walk every page of both formats
+    json_edges, binary_edges, names, offset = {}, {}, None, 0
+    while offset is not None:
+        page = GraphExport(graph, offset=offset, limit=2)
+        members = dict(page.json_members())
+        links = list(members['links'])
+        nodes = list(members['nodes'])
+        assert len(nodes) <= 2 and members['total_nodes'] == 5
+        json_edges.update(((link['source'], link['target']), link['weight']) for link in links)
+        
+        decoded = decode_binary(b''.join(GraphExport(graph, offset=offset, limit=2).iter_binary()), names)
+        names = decoded['names']
+        binary_edges.update(((source, target), weight) for source, target, weight in decoded['edges'])
+        offset = decoded['next_offset']
+        assert offset == members['next_offset']
+    
+    assert json_edges == expected, "JSON pages must cover every edge exactly"
+    assert binary_edges.keys() == expected.keys()
+    step = GraphExport(graph).weight_step
+    assert all(abs(binary_edges[key] - weight) <= step / 2 + 1e-9 for key, weight in expected.items())
+    
+    top = dict(GraphExport(graph, top_k=1).json_members())
+    assert len(list(top['links'])) == 5, "top_k=1 keeps one edge per node"
+    print(f"✓ {len(expected)} edges over {graph.node_count()} nodes, pages of 2")
+    
+    print("\n✅ GRAPH EXPORT TEST PASSED!")
+    return True
+
+def test_product_catalog():
+    """Test catalog snapshot round trip and rejection of corrupt files"""
+    print("\n" + "="*60)
+    print("TESTING PRODUCT CATALOG")
+    print("="*60)
+    
+    import os
+    import types
+    import struct
+    import tempfile
+    from data_structures.product_catalog import (ProductCatalog, write_catalog, build_catalog_bytes,
+                                                 HEADER, SECTION)
+    
+    products = [
+        {'id': 1, 'title': 'Lipstick', 'category': 'beauty', 'price': 9.99, 'rating': 4.5, 'stock': 3,
+         'tags': ['red', 'matte'], 'dimensions': {'width': 1.5}},
+        {'id': 2, 'title': 'Crème brûlée', 'category': 'groceries', 'price': 12, 'stock': 0},  # int price
+        {'id': 3, 'title': None, 'brand': 'Acme', 'rating': float('inf')},
+        {'title': 'No id', 'price': 1.0},
+    ]
+    
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, 'products.catalog')
+        write_catalog(products, path)
+        catalog = ProductCatalog.open(path)
+        assert len(catalog) == len(products) and list(catalog) == products, "Round trip changed products"
+        assert catalog.field(0, 'tags') == ['red', 'matte'] and catalog.field(3, 'id') is None
+        assert catalog.labels('category') == ['beauty', 'groceries', None, None]
+        print(f"✓ Round trip: {len(catalog)} products, {catalog.memory_bytes()} bytes")
+        
+        data = build_catalog_bytes(products)
+        
+        def patched(position, fmt, value):
+            corrupt = bytearray(data)
+            struct.pack_into(fmt, corrupt, position, value)
+            return bytes(corrupt)
+        
+        # Section entry: name (24s), kind (1s), pad (7x), offset (Q), size (Q)
+        first_section = HEADER.size
+        corrupt_files = {
+            'truncated': data[:len(data) // 2],
+            'header only': data[:HEADER.size - 1],
+            'bad magic': b'XXXX' + data[4:],
+            'row count': patched(8, '<Q', len(products) + 1),
+            'string count': patched(16, '<Q', 10 ** 6),
+            'section count': patched(6, '<H', 500),
+            'section offset': patched(first_section + 32, '<Q', len(data)),
+            'section size': patched(first_section + 40, '<Q', 8 * (len(products) - 1)),
+        }
+        for label, corrupt in corrupt_files.items():
+            try:
+                ProductCatalog(corrupt, source=label)
+                assert False, f"Corrupt catalog accepted: {label}"
+            except ValueError:
+                pass
+        print(f"✓ Rejected {len(corrupt_files)} corrupt snapshots with ValueError")
+        
+        # A corrupt snapshot makes the shopping server fall back to the network
+        if 'requests' not in sys.modules:
+            try:
+                import requests
+            except ImportError:
+                sys.modules['requests'] = types.ModuleType('requests')  # Stubbed below anyway
+        import shopping_recommendations as shop
+        
+        with open(path, 'wb') as handle:
+            handle.write(corrupt_files['truncated'])
+        saved = shop.CATALOG_PATH, getattr(shop.requests, 'get', None)
+        shop.CATALOG_PATH = path
+        shop.requests.get = lambda url, **kwargs: types.SimpleNamespace(json=lambda: {'products': products[:2]})
+        try:
+            shop.load_data()
+        finally:
+            shop.CATALOG_PATH, shop.requests.get = saved
+        assert shop.PRODUCTS_DB.source == 'network' and list(shop.PRODUCTS_DB) == products[:2]
+        assert shop.ID_INDEX.get(2) == 1
+        print("✓ Corrupt snapshot falls back to the network catalog")
+    
+    print("\n✅ PRODUCT CATALOG TEST PASSED!")
+    return True
+
+def test_batch_routes():
+    """Test the movies and shopping batch endpoints with the Flask test client"""
+    print("\n" + "="*60)
+    print("TESTING BATCH ENDPOINTS")
+    print("="*60)
+    
+    import types
+    import movies_recommendations as movies
+    
+    client = movies.app.test_client()
+    payload = {'watchlist': [{'genres': ['Drama', 'Action']}, {'genres': ['Drama']}],
+               'users': [{'preferences': {'movies': 'Comedy'}}]}
+    reordered = {'users': payload['users'], 'watchlist': payload['watchlist']}
+    
+    calls = []
+    analyze = movies.analyze_genres
+    movies.analyze_genres = lambda item: calls.append(item) or analyze(item)
+    try:
+        response = client.post('/recommend/batch', json={'requests': [payload, {'watchlist': 5}, reordered,
+                                                                      'oops', {}]})
+    finally:
+        movies.analyze_genres = analyze
+    results = response.get_json()['results']
+    assert response.status_code == 200 and len(results) == 5
+    assert results[0] == client.post('/recommend', json=payload).get_json(), "Batch must match /recommend"
+    assert results[2] == results[0], "Duplicate payloads must get identical results"
+    assert results[1] is None and results[3] is None, "A failing payload must be null in its position"
+    assert results[4] == ['Action', 'Drama', 'Comedy', 'Thriller', 'Sci-Fi']
+    assert len(calls) == 3, "Duplicate payloads must be ranked once"
+    
+    response = client.post('/recommend/batch', data='{"requests": [', content_type='application/json')
+    assert response.status_code == 400 and response.data == b'Invalid JSON'
+    for body in ({'requests': []}, {'requests': {}}, [payload], {'requests': [{}] * (movies.MAX_BATCH_SIZE + 1)}):
+        response = client.post('/recommend/batch', json=body)
+        assert response.status_code == 400 and set(response.get_json()) == {'error'}
+    print("✓ Movies /recommend/batch: duplicates, null on failure, error shapes")
+    
+    if 'requests' not in sys.modules:
+        try:
+            import requests
+        except ImportError:
+            sys.modules['requests'] = types.ModuleType('requests')  # Never called: the catalog is set below
+    import shopping_recommendations as shop
+    from data_structures.product_catalog import ProductCatalog
+    
+    products = [
+        {'id': 1, 'title': 'Lipstick', 'category': 'makeup', 'price': 9.99, 'rating': 4.5},
+        {'id': 2, 'title': 'Perfume', 'category': 'fragrances', 'price': 59.0, 'rating': 4.1},
+        {'id': 3, 'title': 'Laptop', 'category': 'laptops', 'price': 999.0, 'rating': 4.8},
+        {'id': 4, 'title': 'Mascara', 'category': 'makeup', 'price': 14.5, 'rating': 3.9},
+    ]
+    saved = shop.PRODUCTS_DB
+    shop.PRODUCTS_DB = ProductCatalog.from_products(products)
+    shop.build_indexes()
+    try:
+        client = shop.app.test_client()
+        cart = {'cart': [{'id': 1, 'category': 'makeup', 'price': 9.99}], 'strategy': 'hybrid'}
+        response = client.post('/api/recommend/batch', json={'requests': [cart, {'cart': 5}, cart, 'oops', {}]})
+        results = response.get_json()['results']
+        assert response.status_code == 200 and len(results) == 5
+        assert results[0] == client.post('/api/recommend', json=cart).get_json(), "Batch must match /api/recommend"
+        assert [product['id'] for product in results[0]] == [4, 2]
+        assert results[2] == results[0], "Duplicate carts must get identical results"
+        assert results[1] is None and results[3] is None, "A failing cart must be null in its position"
+        assert [product['id'] for product in results[4]] == [3, 1, 2, 4], "An empty cart gets the cold start list"
+        
+        response = client.post('/api/recommend/batch', data='{"requests": [', content_type='application/json')
+        assert response.status_code == 400 and set(response.get_json()) == {'error'}
+        for body in ({'requests': []}, {'cart': []}, [cart]):
+            response = client.post('/api/recommend/batch', json=body)
+            assert response.status_code == 400 and set(response.get_json()) == {'error'}
+    finally:
+        shop.PRODUCTS_DB = saved
+        shop.build_indexes()
+    print("✓ Shopping /api/recommend/batch: duplicates, null on failure, error shapes")
+    
+    print("\n✅ BATCH ENDPOINTS TEST PASSED!")
+    return True
+
+def test_id_index():
+    """Test product id -> row index (dense and hash modes)"""
+    print("\n" + "="*60)
+    print("TESTING ID INDEX")
+    print("="*60)
+    
+    from data_structures.id_index import IdIndex
+    
+    dense = IdIndex([3, 1, 2, None, 3])
+    sparse = IdIndex([10 ** 12, -7, 42, 10 ** 12])
+    
+    assert dense.mode == 'dense' and sparse.mode == 'hash'
+    assert dense.get(3) == 0 and dense.get(2) == 2 and dense.get(99) is None, "Dense lookups are wrong"
+    assert sparse.get(10 ** 12) == 0 and sparse.get(-7) == 1 and sparse.get(5) is None, "Hash lookups are wrong"
+    print(f"✓ Dense: {len(dense)} ids, {dense.memory_bytes()} bytes")
+    print(f"✓ Hash: {len(sparse)} ids, {sparse.memory_bytes()} bytes")
+    
+    print("\n✅ ID INDEX TEST PASSED!")
+    return True
+
+def test_roaring_bitmap():
+    """Test roaring bitmap set operations and paging"""
+    print("\n" + "="*60)
+    print("TESTING ROARING BITMAP")
+    print("="*60)
+    
+    from data_structures.roaring_bitmap import RoaringBitmap
+    
+    evens = RoaringBitmap.from_sorted(range(0, 200000, 2))  # Bitset chunks
+    sparse = RoaringBitmap.from_sorted([3, 10, 70000, 150002])  # Array chunks
+    
+    assert list(evens & sparse) == [10, 70000, 150002], "AND is wrong"
+    assert len(evens | sparse) == 100001, "OR is wrong"
+    assert evens.page(70000, 3) == [140000, 140002, 140004], "Paging is wrong"
+    assert 70000 in sparse and 70001 not in evens
+    print(f"✓ {len(evens)} values in {evens.memory_bytes()} bytes")
+    
+    print("\n✅ ROARING BITMAP TEST PASSED!")
+    return True
+
+def test_facet_index():
+    """Test bitmap facet filters and counts against a scan"""
+    print("\n" + "="*60)
+    print("TESTING FACET INDEX")
+    print("="*60)
+    
+    from data_structures.product_catalog import ProductCatalog
+    from data_structures.facet_index import FacetIndex
+    
+    rng = random.Random(5)
+    products = [{
+        'id': i,
+        'title': f"{rng.choice(['Red', 'Blue', 'Green'])} item {i}",
+        'category': rng.choice(['beauty', 'groceries', 'laptops']),
+        'brand': rng.choice(['Acme', 'Globex', 'Initech']),
+        'price': round(rng.uniform(1, 1500), 2),
+        'rating': round(rng.uniform(0, 5), 2),
+        'stock': rng.randint(0, 3)
+    } for i in range(3000)]
+    catalog = ProductCatalog.from_products(products)
+    index = FacetIndex(catalog)
+    
+    def value(product, facet):
+        if facet == 'price':
+            return FacetIndex.price_bucket(product['price'])
+        if facet == 'rating':
+            return FacetIndex.rating_bucket(product['rating'])
+        if facet == 'in_stock':
+            return 'true' if product['stock'] > 0 else 'false'
+        return product[facet]
+    
+    def scan(selected, term=None, exclude=None):
+        return [row for row, product in enumerate(products)
+                if all(value(product, facet) in values for facet, values in selected.items() if facet != exclude)
+                and (term is None or term in product['title'].lower())]
+    
+    selections = [
+        {},
+        {'category': ['laptops']},
+        {'category': ['beauty', 'groceries'], 'in_stock': ['true']},
+        {'brand': ['Acme'], 'price': ['100-250', '1000+'], 'rating': index.ratings_at_least(4)},
+    ]
+    for selected in selections:
+        assert list(index.filter(selected)) == scan(selected), f"Filter {selected} is wrong"
+        for facet, counts in index.counts(selected).items():
+            rows = scan(selected, exclude=facet)
+            for facet_value, count in counts.items():
+                assert count == sum(1 for row in rows if value(products[row], facet) == facet_value)
+    
+    matched = index.filter({'brand': ['Globex']}, extra=[index.search('BLUE')])
+    assert list(matched) == scan({'brand': ['Globex']}, term='blue'), "Title search is wrong"
+    assert matched.page(1, 2) == list(matched)[1:3]
+    print(f"✓ {len(selections)} filters and their facet counts match a scan of {len(products)} products")
+    
+    print("\n✅ FACET INDEX TEST PASSED!")
+    return True
+
 def run_all_tests():
     """Run all tests"""
     print("\n" + "="*60)
@@ -303,10 +1188,25 @@ def run_all_tests():
         ("Max Heap", test_heap),
         ("Trie", test_trie),
         ("BST", test_bst),
+        ("Feature Store", test_feature_store),
+        ("MinHash LSH", test_playlist_lsh),
         ("Dijkstra", test_dijkstra),
         ("Sorting", test_sorting),
         ("Clustering", test_clustering),
         ("Analyzer", test_analyzer),
+        ("JSON Streaming", test_json_io),
+        ("Response Cache", test_response_cache),
+        ("Sessions", test_sessions),
+        ("Response Fields", test_response_fields),
+        ("Metrics", test_metrics),
+        ("Stage Pipeline", test_stage_pipeline),
+        ("Playlist Events", test_playlist_events),
+        ("Graph Export", test_graph_export),
+        ("Product Catalog", test_product_catalog),
+        ("Batch Endpoints", test_batch_routes),
+        ("Id Index", test_id_index),
+        ("Roaring Bitmap", test_roaring_bitmap),
+        ("Facet Index", test_facet_index),
     ]
     
     passed = 0